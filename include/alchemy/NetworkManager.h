@@ -5,8 +5,15 @@
 #include <cstring>
 #include <cstdlib>
 #include "player.h"
+#include "network_protocol.h"
+#include "interpolationBuffer.h"
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <deque>
+#include <string>
 #include <ctime>
+#include <chrono>
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <winsock2.h>
@@ -18,70 +25,131 @@
 #include <fcntl.h>
 #endif
 
-#define SERVER_PORT 8080
-#define BUFFER_SIZE 256
+class NetworkManager {
+public:
+    NetworkManager();
+    ~NetworkManager();
 
-enum MessageType {
-    PlayerMovement = 0,
-    PlayerAttack = 1,
-    ChatMessage = 2,
-    heartBeat = 3,
-};
+    void setupUDPClient();
+    bool connectToServer();
+    int getPlayerId() const;
+    // Queued messages go out together in one ClientUpdate when flushOutgoing() runs, once per tick
+    void queueChatMessage(const char* message);
+    // True while a server tick's input is due to be sampled, see clockSync.h. lookahead is
+    // how long until we next ask, so an input due before then is sampled now rather than late.
+    bool inputDue(double lookahead);
+    // Samples the held buttons for the tick inputDue() found: moves our predicted position and queues the input for the server
+    void queueInput(uint8_t buttons);
+    void queueViewRadius(float radius);
+    void flushOutgoing();
+    // Applies complete snapshots: buffers remote players' positions and queues them entering or leaving view
+    bool receiveData();
+    // Moves remote players along their buffered positions, once per frame, and adds or removes
+    // those whose change in view the render time has reached. True if any were added.
+    bool interpolatePlayers(std::unordered_map<int, Player>& players);
+    void setInterpolationDelay(double seconds);
+    glm::vec2 getPredictedPosition() const; // Where our inputs have taken us, corrected by the server
+    double getRoundTripTime() const; // Seconds, smoothed, 0 until the server has acked something
+    double getPacketLoss() const;    // Fraction of our packets the server never acked
 
-struct OutGoingPacket {
-    MessageType type;
-    int clientId;
-    union {
-        struct {
-            float x, y;
-        } movementData;
-        struct {
-            int targetId;
-            int attackPower;
-        } attackData;
-        struct {
-            char message[BUFFER_SIZE - sizeof(MessageType) - sizeof(int)];
-        } chatData;
-        struct {
-            bool alive;
-        } heartBeat;
+private:
+    struct ReceivedSnapshot {
+        uint32_t tick = 0;
+        uint32_t inputAck = 0;
+        std::vector<PlayerPosition> players; // Sorted by player id
     };
-};
 
-struct PlayerPosition {
-    int playerId;
-    float x, y;
-};
+    // One of our inputs and the position predicting it left us at
+    struct PredictedInput {
+        uint32_t tick = 0;
+        uint8_t buttons = 0;
+        float x = 0.0f, y = 0.0f;
+    };
 
-struct IncomingPacket {
-    MessageType type;
-    union {
-        struct {
-            int numPlayers;
-            PlayerPosition players[BUFFER_SIZE / sizeof(PlayerPosition)];
-        } movementUpdates;
-        struct {
-            char message[BUFFER_SIZE - sizeof(MessageType)];
-        } chatData;
+    // A delta entry for a player that moved, as a step in quantized position units
+    struct PositionStep {
+        int playerId;
+        int32_t dx, dy;
     };
-};
 
-class NetworkManager {
-public:
-    NetworkManager();
-    ~NetworkManager();
+    // Parts of one snapshot, collected until every part has arrived
+    struct SnapshotAssembly {
+        uint32_t tick = 0;
+        uint32_t inputAck = 0;
+        MessageType type = PlayerMovement;
+        uint16_t partCount = 0;
+        uint32_t receivedParts = 0; // One bit per part index
+        uint32_t baselineTick = 0;
+        int fractionBits = 0;
+        std::chrono::steady_clock::time_point startedAt;
+        std::vector<PlayerPosition> players; // Full snapshot entries, or delta additions
+        std::vector<int> removed;
+        std::vector<PositionStep> changed;
+    };
 
-    void setupUDPClient();
-    void sendChatMessage(int clientId, const char* message);
-    void sendPlayerMovement(int clientId, float x, float y);
-    void sendHeatBeat(int clientId);
-    bool receiveData(std::unordered_map<int, Player>& players);
+    void stampHeader(OutGoingPacket& packet);
+    bool addSnapshotPart(const IncomingPacket& packet, int bytesReceived);
+    bool decodeFullSnapshotPart(const IncomingPacket& packet, int bytesReceived, SnapshotAssembly& assembly);
+    bool decodeDeltaSnapshotPart(const IncomingPacket& packet, int bytesReceived, SnapshotAssembly& assembly);
+    bool completeSnapshot(SnapshotAssembly& assembly, ReceivedSnapshot& snapshot);
+    void applySnapshot(const ReceivedSnapshot& snapshot);
+    void reconcile(const ReceivedSnapshot& snapshot);
 
-private:
     SOCKET sock;
     struct sockaddr_in serv_addr, client_addr;
     char buffer[BUFFER_SIZE];
     int client_addr_len;
+
+    // Recent snapshots indexed by tick, the baselines deltas are applied to
+    ReceivedSnapshot snapshotHistory[SNAPSHOT_HISTORY];
+    ReceivedSnapshot decodedSnapshot;
+    SnapshotAssembly assemblies[SNAPSHOT_ASSEMBLY_SLOTS];
+    uint32_t latestSnapshotTick;
+
+    // A remote player entering or leaving view in the snapshot for tick
+    struct VisibilityChange {
+        uint32_t tick;
+        int playerId;
+        bool visible;
+    };
+
+    // Remote players' positions by player id, drawn interpolationDelay behind the newest snapshot
+    std::unordered_map<int, InterpolationBuffer> remotePlayers;
+    std::unordered_set<int> visiblePlayers; // In view as of the newest snapshot, ahead of the players drawn
+    std::deque<VisibilityChange> visibilityChanges; // Not yet reached by the render time, oldest first
+    double interpolationDelay;
+    double renderTick; // Never runs backwards, however the clock estimate moves
+
+    // Sequence numbers and acks for both directions, see packetSequence.h
+    ReceiveWindow receiveWindow;
+    AckTracker ackTracker;
+    std::chrono::steady_clock::time_point newestReceivedAt; // Arrival of the datagram we ack, for PacketHeader::ackDelay
+
+    // The server's clock and tick grid as seen from ours
+    ClockSync clock{ SERVER_TICK_INTERVAL };
+    std::chrono::steady_clock::time_point lastSyncAt;
+    uint32_t nextInputTick; // Server tick the next input is for, 0 until synchronized
+    uint32_t sampleTick;    // Tick the input being sampled is for, 0 when none is due
+    std::chrono::steady_clock::time_point nextUnsyncedInput;
+
+    // Inputs by the server tick they are stamped for, resent until the server has applied them, see playerInput.h
+    PredictedInput inputHistory[INPUT_HISTORY];
+    uint32_t inputTick; // Newest input queued
+    uint32_t inputAck;  // Newest input the server has applied
+    uint8_t lastButtons;
+    float predictedX, predictedY;
+    float spawnX, spawnY; // Where we stood before the first input
+
+    // Outgoing messages waiting for the next flushOutgoing()
+    float viewRadius;
+    bool viewRadiusPending;
+    std::deque<std::string> pendingChat;
+    int datagramsSinceSend; // Received but not yet acked by anything we sent
+    std::chrono::steady_clock::time_point lastSendAt;
+
+    // Assigned by the server during the handshake and echoed in every packet
+    uint16_t slot;
+    uint16_t generation;
 };
 
 #endif
@@ -0,0 +1,169 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+// Little-endian bit packing shared by the server's snapshot encoder and the
+// client's decoder. Values are written least significant bit first, so the
+// layout is the same on every host regardless of its byte order.
+//
+// Writers never write past their buffer: a write that does not fit sets the
+// overflow flag and is dropped, and rewind() lets the caller back out a
+// partially written entry once the budget is reached.
+class BitWriter {
+public:
+    BitWriter(unsigned char* buffer, size_t capacityBytes)
+        : buffer(buffer), capacityBits(capacityBytes * 8), position(0), overflow(false) {}
+
+    void writeBits(uint32_t value, int bits) {
+        if (overflow || position + bits > capacityBits) {
+            overflow = true;
+            return;
+        }
+
+        while (bits > 0) {
+            size_t byteIndex = position / 8;
+            int bitOffset = static_cast<int>(position % 8);
+            if (bitOffset == 0) {
+                buffer[byteIndex] = 0;
+            }
+
+            int chunk = bits < 8 - bitOffset ? bits : 8 - bitOffset;
+            uint32_t mask = (1u << chunk) - 1;
+            buffer[byteIndex] |= static_cast<unsigned char>((value & mask) << bitOffset);
+
+            value >>= chunk;
+            bits -= chunk;
+            position += chunk;
+        }
+    }
+
+    // 7 payload bits per group plus a continuation bit
+    void writeVarint(uint32_t value) {
+        while (value >= 0x80) {
+            writeBits((value & 0x7F) | 0x80, 8);
+            value >>= 7;
+        }
+        writeBits(value, 8);
+    }
+
+    // Zigzag first so small negative values stay small
+    void writeSignedVarint(int32_t value) {
+        writeVarint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    // Overwrites a field reserved earlier, e.g. a count only known at the end,
+    // without disturbing the bits written after it.
+    void patchBits(size_t bitPosition, uint32_t value, int bits) {
+        if (bitPosition + bits > position) {
+            return;
+        }
+
+        while (bits > 0) {
+            int bitOffset = static_cast<int>(bitPosition % 8);
+            int chunk = bits < 8 - bitOffset ? bits : 8 - bitOffset;
+            unsigned char mask = static_cast<unsigned char>(((1u << chunk) - 1) << bitOffset);
+            unsigned char& target = buffer[bitPosition / 8];
+            target = static_cast<unsigned char>((target & ~mask) | ((value << bitOffset) & mask));
+
+            value >>= chunk;
+            bits -= chunk;
+            bitPosition += chunk;
+        }
+    }
+
+    void rewind(size_t bitPosition) {
+        position = bitPosition;
+        overflow = false;
+        if (position % 8 != 0) {
+            buffer[position / 8] &= static_cast<unsigned char>((1u << (position % 8)) - 1);
+        }
+    }
+
+    size_t bitPosition() const { return position; }
+    size_t bytesWritten() const { return (position + 7) / 8; }
+    bool overflowed() const { return overflow; }
+
+private:
+    unsigned char* buffer;
+    size_t capacityBits;
+    size_t position;
+    bool overflow;
+};
+
+class BitReader {
+public:
+    BitReader(const unsigned char* buffer, size_t sizeBytes)
+        : buffer(buffer), sizeBits(sizeBytes * 8), position(0), overflow(false) {}
+
+    uint32_t readBits(int bits) {
+        if (overflow || position + bits > sizeBits) {
+            overflow = true;
+            return 0;
+        }
+
+        uint32_t value = 0;
+        int shift = 0;
+        while (bits > 0) {
+            int bitOffset = static_cast<int>(position % 8);
+            int chunk = bits < 8 - bitOffset ? bits : 8 - bitOffset;
+            uint32_t mask = (1u << chunk) - 1;
+            value |= ((static_cast<uint32_t>(buffer[position / 8]) >> bitOffset) & mask) << shift;
+
+            shift += chunk;
+            bits -= chunk;
+            position += chunk;
+        }
+        return value;
+    }
+
+    uint32_t readVarint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint32_t group = readBits(8);
+            value |= (group & 0x7F) << shift;
+            if ((group & 0x80) == 0 || overflow) {
+                return value;
+            }
+        }
+        overflow = true;
+        return 0;
+    }
+
+    int32_t readSignedVarint() {
+        uint32_t value = readVarint();
+        return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    // True once any read ran past the end; everything read since is garbage
+    bool overflowed() const { return overflow; }
+
+private:
+    const unsigned char* buffer;
+    size_t sizeBits;
+    size_t position;
+    bool overflow;
+};
+
+// Fixed-point world positions: value * 2^fractionBits, rounded
+inline int32_t quantizePosition(float value, int fractionBits) {
+    return static_cast<int32_t>(std::lround(std::ldexp(value, fractionBits)));
+}
+
+inline float dequantizePosition(int32_t value, int fractionBits) {
+    return std::ldexp(static_cast<float>(value), -fractionBits);
+}
+
+// Bits needed to hold every value in [0, range]
+inline int bitWidth(uint32_t range) {
+    int bits = 0;
+    while (range > 0) {
+        ++bits;
+        range >>= 1;
+    }
+    return bits;
+}
+
+#endif // BITSTREAM_H
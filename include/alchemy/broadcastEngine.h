@@ -0,0 +1,77 @@
+#ifndef BROADCAST_ENGINE_H
+#define BROADCAST_ENGINE_H
+
+#include "socketPlatform.h"
+#include "ioUring.h"
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+// Collects every datagram the server wants to send during one tick and hands
+// them to the kernel together. On Linux that is one sendmmsg call per
+// SENDMMSG_MAX_BATCH datagrams; consecutive equal-sized datagrams to the same
+// client can additionally be merged into a single UDP_SEGMENT (GSO) send.
+// Other platforms fall back to one sendto per datagram.
+//
+// With useIoUring the same messages go out as io_uring SENDMSG entries, one
+// io_uring_enter per batch instead of one sendmmsg. The ring is set up on the
+// first flush(), so the thread that flushes is its only submitter as
+// IORING_SETUP_SINGLE_ISSUER requires. If it cannot be set up or a submit
+// fails, that batch and every later one go out with sendmmsg instead.
+//
+// Constructed with INVALID_SOCKET it only counts what it would have sent,
+// which is how capture replay exercises the send path without a network.
+class BroadcastEngine {
+public:
+    struct TickStats {
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        uint64_t syscalls = 0;
+    };
+
+    BroadcastEngine(SOCKET socket, bool useGso, bool useIoUring = false);
+
+    void queue(const sockaddr_in& destination, const void* data, int length);
+    void flush();
+
+    bool gsoEnabled() const;
+    bool ioUringEnabled() const;
+    const TickStats& lastTickStats() const;
+
+private:
+    struct PendingDatagram {
+        sockaddr_in destination;
+        size_t offset;
+        int length;
+    };
+
+#ifdef __linux__
+    void flushBatched();
+#endif
+#ifdef HAS_IO_URING
+    // False if the ring failed; headers is then left holding only what it did not send
+    bool sendWithIoUring();
+#endif
+    void flushSequential();
+
+    SOCKET socket;
+    bool useGso;
+    std::vector<char> payload;
+    std::vector<PendingDatagram> pending;
+    TickStats stats;
+
+#ifdef __linux__
+    // Scratch arrays for sendmmsg, kept between ticks to avoid reallocating
+    std::vector<mmsghdr> headers;
+    std::vector<iovec> iovecs;
+    std::vector<char> controls;
+    std::vector<int> datagramCounts;
+#endif
+#ifdef HAS_IO_URING
+    bool useIoUring;
+    std::unique_ptr<IoUring> ring;
+    std::vector<uint8_t> ringSent; // Per header, set once its completion has been reaped
+#endif
+};
+
+#endif // BROADCAST_ENGINE_H
@@ -0,0 +1,78 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <chrono>
+#include <cstdint>
+
+#define CLOCK_SYNC_SAMPLES 8 // Recent exchanges the offset is taken from, the one with the lowest RTT wins
+#define CLOCK_SYNC_INTERVAL 1.0 // Seconds between exchanges once synchronized
+#define CLOCK_SYNC_FAST_INTERVAL 0.1 // Seconds between exchanges until CLOCK_SYNC_SAMPLES have completed
+#define INPUT_ARRIVAL_MARGIN 0.003 // Seconds ahead of its tick an input aims to arrive, on top of the RTT deviation
+
+// Client side of an NTP-style exchange with the server. A request carries
+// our clock; the reply echoes it with the server's receive and send times
+// and the tick the server was on, so each exchange gives a round trip time
+// and an estimate of the offset between the two clocks:
+//
+//   rtt    = (received - requested) - (serverSent - serverReceived)
+//   offset = ((serverReceived - requested) + (serverSent - received)) / 2
+//
+// The offset is only as good as the path was symmetric, and queueing makes
+// it lopsided, so the offset used is the one from the fastest of the last
+// CLOCK_SYNC_SAMPLES exchanges. RTT and its deviation are smoothed the way
+// TCP does.
+//
+// With the offset, the server's tick grid can be projected onto our clock:
+// targetTick() names the first server tick an input sent now can still
+// arrive ahead of, and sendTime() when an input for a given tick has to
+// leave to arrive INPUT_ARRIVAL_MARGIN plus the RTT deviation before the
+// tick starts. Stamping inputs with server ticks and sending each on time
+// means the server applies it on the tick it was meant for, without
+// holding it in a buffer first.
+class ClockSync {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ClockSync(double tickInterval);
+    void reset();
+
+    // Our clock as carried in a request, wrapping microseconds
+    static uint32_t requestTime(Clock::time_point now);
+
+    // Feeds one reply. Server times are its clock in microseconds; tick started at tickStart.
+    void addSample(uint32_t requestedAt, int64_t serverReceived, int64_t serverSent, uint32_t tick, int64_t tickStart,
+        Clock::time_point received);
+
+    bool synchronized() const { return sampleCount > 0; }
+    int samples() const { return sampleCount; }
+    double offset() const { return bestOffset; } // Seconds to add to our clock to get the server's
+    double rtt() const { return smoothedRtt; }   // Seconds, smoothed
+    double rttDeviation() const { return rttVariance; }
+
+    // The first server tick an input sent now can still arrive ahead of
+    uint32_t targetTick(Clock::time_point now) const;
+    // When an input for tick has to be sent to arrive ahead of it
+    Clock::time_point sendTime(uint32_t tick) const;
+    // How far along its tick grid the server is now, in fractional ticks
+    double serverTick(Clock::time_point now) const;
+
+private:
+    struct Sample {
+        double offset;
+        double rtt;
+    };
+
+    static double seconds(Clock::time_point time);
+    double lead() const; // Seconds from sending an input to when it should be at the server, on its clock
+
+    double tickInterval;
+    Sample window[CLOCK_SYNC_SAMPLES];
+    int sampleCount;
+    double bestOffset;
+    double smoothedRtt;
+    double rttVariance;
+    uint32_t referenceTick;
+    double referenceTime; // Server seconds when referenceTick started
+};
+
+#endif // CLOCK_SYNC_H
@@ -0,0 +1,55 @@
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+#include <chrono>
+#include <cstdint>
+
+#define SEND_BUDGET_INITIAL 131072.0 // Bytes per second a new client may be sent
+#define SEND_BUDGET_MIN 4096.0       // Floor the budget never drops below
+#define SEND_BUDGET_MAX 1048576.0    // Ceiling, well above what one client's snapshots need at full tick rate
+#define SEND_BUDGET_INCREASE 8192.0  // Bytes per second added per clean round trip while budget-limited
+#define SEND_BUDGET_DECREASE 0.7     // Budget kept after a congestion event
+#define SEND_DELAY_THRESHOLD 0.05    // Seconds of RTT above the client's best that count as queueing
+#define SEND_MAX_INTERVAL 16         // Ticks a client may go without a snapshot, however small its budget
+
+// Per-client snapshot pacing for the send thread, additive increase and
+// multiplicative decrease over a byte rate.
+//
+// Each tick the client earns budget * elapsed bytes of credit and is sent a
+// snapshot if it has any; the snapshot's size is then charged, so a client
+// whose snapshots outgrow its budget is skipped on some ticks and its
+// deltas simply span more of them. Credit never builds past one tick's
+// worth, so the server tick stays the upper bound on the snapshot rate.
+//
+// Packet loss, or RTT climbing SEND_DELAY_THRESHOLD above the best seen,
+// cuts the budget by SEND_BUDGET_DECREASE at most once per round trip.
+// Every clean round trip in which the budget held a snapshot back raises it
+// by SEND_BUDGET_INCREASE; a client that already gets every tick does not
+// grow a budget it is not using.
+class CongestionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void reset(Clock::time_point now);
+
+    // Feeds what the client's acks revealed since the last call; rtt in seconds, 0 if unknown
+    void onAcks(uint64_t newlyLost, double rtt, Clock::time_point now);
+
+    // Advances by elapsed seconds of ticks; true if a snapshot should go out now
+    bool due(double elapsed);
+    void onSent(int bytes);
+
+    double budget() const { return bytesPerSecond; } // Bytes per second
+    bool limited() const { return ticksSinceSend > 0; } // Held back on the latest tick
+
+private:
+    double bytesPerSecond = SEND_BUDGET_INITIAL;
+    double credit = 0.0;
+    double bestRtt = 0.0;
+    int ticksSinceSend = 0;
+    uint64_t lostThisRound = 0;
+    bool limitedThisRound = false;
+    Clock::time_point roundStart;
+};
+
+#endif // CONGESTION_CONTROL_H
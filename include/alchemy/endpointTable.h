@@ -0,0 +1,45 @@
+#ifndef ENDPOINT_TABLE_H
+#define ENDPOINT_TABLE_H
+
+#include <alchemy/socketPlatform.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Flat open-addressing map from a full IPv4 endpoint (address and port) to a
+// small integer, the server's session lookup by source address. Entries sit
+// inline in one array with linear probing, so a lookup is one hash and
+// usually one cache line, and erase shifts the rest of the run back rather
+// than leaving tombstones, so probe lengths never degrade with churn.
+//
+// Sized once for a fixed number of entries at half load and never rehashed.
+//
+// Not thread-safe: owned by the tick thread.
+class EndpointTable {
+public:
+    explicit EndpointTable(int capacity);
+
+    // Returns the value stored for the endpoint, or -1
+    int find(const sockaddr_in& endpoint) const;
+    // Adds or replaces the endpoint's value; returns false when the table is full
+    bool insert(const sockaddr_in& endpoint, int value);
+    bool erase(const sockaddr_in& endpoint);
+    size_t size() const;
+
+private:
+    struct Entry {
+        uint32_t ip;
+        uint16_t port;
+        int32_t value; // -1 while empty
+    };
+
+    size_t home(uint32_t ip, uint16_t port) const;
+    size_t locate(uint32_t ip, uint16_t port) const;
+
+    std::vector<Entry> entries;
+    size_t mask;
+    size_t capacity;
+    size_t count;
+};
+
+#endif // ENDPOINT_TABLE_H
@@ -19,7 +19,8 @@ enum class Mode {
 
 class Game {
 public:
-    Game(Mode mode);
+    // interpolationDelay is how far behind the newest snapshot remote players are drawn, in seconds
+    Game(Mode mode, double interpolationDelay = INTERPOLATION_DELAY);
     ~Game();
 
     void run();
@@ -58,6 +59,9 @@ private:
     static const char* redFragmentShaderSource;
 
     float cameraZoom;
+    float viewRadius;
+    float lastSentViewRadius;
+    int ticksSinceViewRadiusSent;
     Mode currentMode;
     Render renderer; 
 };
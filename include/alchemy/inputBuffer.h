@@ -0,0 +1,55 @@
+#ifndef INPUT_BUFFER_H
+#define INPUT_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define INPUT_BUFFER_SIZE 32 // Inputs one client may have waiting, power of two
+#define INPUT_MAX_PER_TICK 2 // Late inputs applied on one tick while catching up
+
+// Per-client buffer between input datagrams and the fixed-step simulation.
+// Clients stamp each input with the server tick it is meant for and time
+// their sends so it arrives just before that tick (see clockSync.h), so an
+// input that arrives early simply waits here for its tick. One that misses
+// its tick is applied on the next, two per tick at most, so a burst of late
+// inputs drains without one tick moving a player several steps.
+//
+// Stamps are server ticks and an idle client sends nothing, so gaps between
+// them are normal. Inputs are never dropped for being late, so the server
+// applies the same inputs the client predicted with; only an input that a
+// newer one a whole buffer ahead lands on top of is lost.
+//
+// Not thread-safe: one per player slot, owned by the tick thread.
+class InputBuffer {
+public:
+    InputBuffer();
+    void reset();
+
+    // Stores one input; false if it was applied or buffered already
+    bool push(uint32_t tick, uint8_t buttons);
+
+    // Writes the inputs due by this server tick to buttons (room for
+    // INPUT_MAX_PER_TICK), oldest first, and returns how many
+    int consume(uint32_t tick, uint8_t* buttons);
+
+    uint32_t lastApplied() const { return applied; } // Stamp of the newest input applied, 0 before the first
+    size_t depth() const { return buffered; }
+    uint64_t late() const { return lateCount; }       // Inputs applied after the tick they were stamped for
+    uint64_t skipped() const { return skippedCount; } // Inputs overwritten before they were applied
+
+private:
+    struct Entry {
+        uint32_t tick = 0;
+        uint8_t buttons = 0;
+    };
+
+    const Entry* oldest() const;
+
+    Entry entries[INPUT_BUFFER_SIZE];
+    uint32_t applied;
+    size_t buffered;
+    uint64_t lateCount;
+    uint64_t skippedCount;
+};
+
+#endif // INPUT_BUFFER_H
@@ -0,0 +1,48 @@
+#ifndef INTERPOLATION_BUFFER_H
+#define INTERPOLATION_BUFFER_H
+
+#include <cstdint>
+
+#define INTERPOLATION_BUFFER_SIZE 32 // Positions kept per remote player, half a second of ticks
+#define INTERPOLATION_DELAY 0.1 // Default seconds remote players are drawn behind the newest snapshot
+#define EXTRAPOLATION_LIMIT 0.1 // Seconds a remote player keeps moving once its snapshots stop coming
+
+// Positions one remote player had in the snapshots we received, by server
+// tick. Remote players are drawn a little in the past, between two
+// snapshots that have both arrived, so their motion is as smooth as the
+// simulation rather than as smooth as the network: a late or lost snapshot
+// just means interpolating across a wider gap, and the server can send
+// fewer of them.
+//
+// When the render time runs past the newest position (a burst of loss, or
+// a delay too short for the snapshot rate) the player is carried along its
+// last velocity, but only for EXTRAPOLATION_LIMIT; after that it waits where
+// it is rather than walk on through whatever it may have stopped at.
+class InterpolationBuffer {
+public:
+    InterpolationBuffer();
+    void reset();
+
+    // Records where the player was on tick; older ticks than the newest are ignored
+    void push(uint32_t tick, float x, float y);
+    // Forgets positions older than tick, so a player back in view does not glide over from where it left
+    void dropBefore(uint32_t tick);
+
+    // Writes where the player was at a fractional server tick, extrapolating at most maxExtrapolation ticks
+    void sample(double renderTick, double maxExtrapolation, float& x, float& y) const;
+
+    bool empty() const { return count == 0; }
+    uint32_t newestTick() const { return entries[newest].tick; }
+
+private:
+    struct Entry {
+        uint32_t tick = 0;
+        float x = 0.0f, y = 0.0f;
+    };
+
+    Entry entries[INTERPOLATION_BUFFER_SIZE];
+    int newest;
+    int count;
+};
+
+#endif // INTERPOLATION_BUFFER_H
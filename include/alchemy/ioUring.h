@@ -0,0 +1,85 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+// Multishot receive needs the 6.0 uapi header; older headers build without the backend
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_RECV_MULTISHOT
+#define HAS_IO_URING 1
+#endif
+#endif
+
+#ifdef HAS_IO_URING
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define IO_URING_QUEUE_DEPTH 1024 // Submission entries per ring, the completion queue is twice that
+#define IO_URING_RECV_BUFFERS 1024 // Provided receive buffers per shard, power of two
+
+// Just enough io_uring for the server, over the raw syscalls so there is no
+// liburing dependency. One thread owns a ring: it queues entries with
+// getSqe(), hands them to the kernel with submit() and reaps completions
+// with peekCqe()/seen().
+//
+// A ring can also own one provided buffer ring. Its buffers are allocated and
+// registered once; multishot receives pick one per datagram and the owner
+// hands each back with recycleBuffer() once the datagram is decoded.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // True if this kernel can set up a ring and register provided buffers
+    static bool supported();
+
+    // Next free submission entry, zeroed; nullptr once the queue is full until the next submit()
+    io_uring_sqe* getSqe();
+    // Submits everything queued and waits for at least waitFor completions. Returns -errno on failure.
+    int submit(unsigned waitFor);
+    // Oldest unseen completion or nullptr; seen() releases it back to the kernel
+    io_uring_cqe* peekCqe();
+    void seen();
+
+    void registerBufferRing(uint16_t groupId, unsigned count, unsigned size);
+    unsigned char* buffer(uint16_t id);
+    unsigned bufferSize() const;
+    void recycleBuffer(uint16_t id);
+    // Makes recycled buffers visible to the kernel with one store
+    void commitBuffers();
+
+private:
+    int ringFd = -1;
+
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned sqEntries;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned sqLocalTail = 0;
+
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    // Entries of the provided buffer ring; the shared tail overlays the first entry's resv field.
+    // io_uring_buf_ring itself is not used because its flex array member is misplaced in C++.
+    io_uring_buf* bufferRing = nullptr;
+    size_t bufferRingSize = 0;
+    unsigned bufferMask = 0;
+    unsigned bufferBytes = 0;
+    uint16_t bufferTail = 0;
+    std::unique_ptr<unsigned char[]> bufferPool;
+};
+#endif
+
+#endif // IO_URING_H
@@ -0,0 +1,216 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+// Calls below this level are removed by the preprocessor, arguments included
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS 8 // Arguments one record can carry
+#define LOG_TEXT_CAPACITY 128 // Bytes of string arguments one record can carry, longer ones are cut short
+#define LOG_RING_CAPACITY 1024 // Records buffered per thread, power of two
+#define LOG_FLUSH_INTERVAL_MS 20 // How often the background thread formats and writes
+
+// One "{}" in the format per argument. The format is a string literal; string
+// arguments are copied into the record, so e.what() and temporaries are safe.
+#define LOG_AT(level, ...) Logger::instance().write(level, 0, __VA_ARGS__)
+
+// At most perSecond records per second from this call site; the next record
+// that gets through reports how many were suppressed
+#define LOG_AT_RATE(level, perSecond, ...)                                    \
+    do {                                                                      \
+        static LogRateLimiter logRateLimiter(perSecond);                      \
+        uint32_t logSuppressed;                                               \
+        if (logRateLimiter.allow(logSuppressed)) {                            \
+            Logger::instance().write(level, logSuppressed, __VA_ARGS__);      \
+        }                                                                     \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_DEBUG_RATE(perSecond, ...) LOG_AT_RATE(LOG_LEVEL_DEBUG, perSecond, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#define LOG_DEBUG_RATE(perSecond, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_INFO_RATE(perSecond, ...) LOG_AT_RATE(LOG_LEVEL_INFO, perSecond, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#define LOG_INFO_RATE(perSecond, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_WARN_RATE(perSecond, ...) LOG_AT_RATE(LOG_LEVEL_WARN, perSecond, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#define LOG_WARN_RATE(perSecond, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_ERROR_RATE(perSecond, ...) LOG_AT_RATE(LOG_LEVEL_ERROR, perSecond, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#define LOG_ERROR_RATE(perSecond, ...) ((void)0)
+#endif
+
+struct LogArg {
+    enum Type : uint8_t {
+        Int,
+        Uint,
+        Double,
+        String,
+    };
+
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        uint32_t text; // Offset of a string argument in LogRecord::text
+    };
+};
+
+// Fixed-size binary record; formatting happens on the background thread
+struct LogRecord {
+    uint64_t timestamp; // Nanoseconds since the logger started
+    const char* format;
+    uint32_t suppressed;
+    uint8_t level;
+    uint8_t argCount;
+    uint32_t textUsed;
+    LogArg args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_CAPACITY]; // String arguments, each NUL-terminated
+};
+
+// Single-producer single-consumer ring: the owning thread writes, the flusher reads
+class LogRing {
+public:
+    bool tryPush(const LogRecord& record);
+    bool tryPop(LogRecord& record);
+
+private:
+    LogRecord records[LOG_RING_CAPACITY];
+    alignas(64) std::atomic<size_t> head{ 0 };
+    alignas(64) std::atomic<size_t> tail{ 0 };
+};
+
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(uint32_t perSecond);
+
+    // True if this call may log; suppressed is set to the calls dropped since the last one allowed
+    bool allow(uint32_t& suppressed);
+
+private:
+    uint32_t perSecond;
+    std::atomic<int64_t> windowStart{ -1 };
+    std::atomic<uint32_t> windowCount{ 0 };
+    std::atomic<uint32_t> suppressedCount{ 0 };
+};
+
+// Asynchronous logger. write() copies a record into the calling thread's ring
+// and returns; it never blocks, formats or touches a stream. When a ring is
+// full the record is dropped and counted. A background thread drains every
+// ring, orders records by time and writes them, INFO and below to stdout,
+// WARN and above to stderr.
+class Logger {
+public:
+    static Logger& instance();
+
+    template <typename... Args>
+    void write(int level, uint32_t suppressed, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+
+        LogRecord record;
+        record.timestamp = static_cast<uint64_t>((std::chrono::steady_clock::now() - start).count());
+        record.format = format;
+        record.suppressed = suppressed;
+        record.level = static_cast<uint8_t>(level);
+        record.argCount = 0;
+        record.textUsed = 0;
+        (appendArg(record, args), ...);
+
+        if (!threadRing().tryPush(record)) {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Formats and writes everything logged so far before returning
+    void flush();
+
+private:
+    Logger();
+    ~Logger();
+
+    template <typename T>
+    static void appendArg(LogRecord& record, const T& value) {
+        LogArg& arg = record.args[record.argCount++];
+        if constexpr (std::is_same_v<T, bool>) {
+            appendText(record, arg, value ? "true" : "false", value ? 4 : 5);
+        }
+        else if constexpr (std::is_same_v<T, std::string>) {
+            appendText(record, arg, value.data(), value.size());
+        }
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            arg.type = LogArg::Int;
+            arg.i = value;
+        }
+        else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            arg.type = LogArg::Uint;
+            arg.u = static_cast<uint64_t>(value);
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            arg.type = LogArg::Double;
+            arg.d = value;
+        }
+        else {
+            static_assert(std::is_convertible_v<T, const char*>, "Log arguments must be numbers or strings");
+            const char* text = value;
+            if (text == nullptr) {
+                text = "(null)";
+            }
+            appendText(record, arg, text, std::char_traits<char>::length(text));
+        }
+    }
+
+    static void appendText(LogRecord& record, LogArg& arg, const char* text, size_t length);
+
+    LogRing& threadRing();
+    void flushLoop();
+    void drain();
+
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint64_t> droppedRecords{ 0 };
+
+    // Taken when a thread logs for the first time and by the flusher, never per record
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<LogRing>> rings;
+
+    std::mutex drainMutex;
+    std::vector<LogRecord> batch;
+    std::atomic<bool> running{ true };
+    std::thread flusher;
+};
+
+#endif // LOGGER_H
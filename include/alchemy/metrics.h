@@ -0,0 +1,132 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "socketPlatform.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define HISTOGRAM_SUB_BUCKET_BITS 5 // 16 linear buckets per power of two, about 3% relative error
+#define HISTOGRAM_VALUE_BITS 40     // Values clamp at 2^40 - 1, about 18 minutes in nanoseconds
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2) << (HISTOGRAM_SUB_BUCKET_BITS - 1))
+
+// Recording into any metric is a handful of relaxed atomic operations: no
+// locks and no allocation, so it is safe on the tick and network threads.
+// Counters that several threads bump sit on their own cache line.
+
+class Counter {
+public:
+    void add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t load() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<uint64_t> value{ 0 };
+};
+
+class Gauge {
+public:
+    void set(double newValue) { value.store(newValue, std::memory_order_relaxed); }
+    double load() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<double> value{ 0.0 };
+};
+
+// HDR-style histogram of non-negative integers (nanoseconds for durations).
+// Values below 2^HISTOGRAM_SUB_BUCKET_BITS get a bucket each; above that every
+// power of two is split into the same number of linear buckets, so the
+// relative error of any quantile is bounded whatever the magnitude.
+class Histogram {
+public:
+    struct Snapshot {
+        uint64_t counts[HISTOGRAM_BUCKETS];
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+
+        // Highest value equivalent to the one at quantile q, 0 <= q <= 1
+        uint64_t valueAtQuantile(double q) const;
+    };
+
+    void record(uint64_t value);
+    void recordDuration(std::chrono::steady_clock::duration duration) {
+        record(duration.count() > 0 ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()) : 0);
+    }
+
+    // Concurrent records may land half in and half out of the copy; fine for monitoring
+    void snapshot(Snapshot& out) const;
+
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketHighestValue(size_t index);
+
+private:
+    std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS] = {};
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    std::atomic<uint64_t> max{ 0 };
+};
+
+// Owns every metric the server exports. Metrics are registered once at
+// startup and callers keep the returned reference; registration and
+// rendering take a lock, recording never does.
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    // unitScale converts recorded values to the exported unit, e.g. 1e-9 for nanoseconds to seconds
+    Histogram& histogram(const std::string& name, const std::string& help, double unitScale);
+
+    // Prometheus text exposition format; histograms export as summaries with quantile="1" as the max
+    std::string renderPrometheus() const;
+
+private:
+    enum Type {
+        CounterMetric,
+        GaugeMetric,
+        HistogramMetric,
+    };
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        Type type;
+        double unitScale;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+};
+
+// Serves the registry over HTTP on a loopback TCP port, so both Prometheus and
+// curl can scrape it, and optionally rewrites a file with the same text every
+// fileInterval seconds. Runs on its own thread; port 0 disables the listener
+// and an empty path disables the file.
+class MetricsExporter {
+public:
+    MetricsExporter(const MetricsRegistry& registry, int port, const std::string& filePath, double fileInterval);
+    ~MetricsExporter();
+
+private:
+    void openListener(int port);
+    void exportLoop();
+    void serveScrape();
+    void writeFile();
+
+    const MetricsRegistry& registry;
+    SOCKET listener = INVALID_SOCKET;
+    std::string filePath;
+    double fileInterval;
+    std::atomic<bool> running{ true };
+    std::thread exporter;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,85 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queue for many producers and a single consumer.
+// Each slot carries a sequence number (Vyukov's bounded queue): producers
+// claim a slot with one CAS on the tail, the consumer reads slots in order
+// from the head without any atomics contended by producers. Capacity must be
+// a power of two and is allocated once up front. Items pushed by one producer
+// are popped in the order that producer pushed them.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity)
+        : mask(capacity - 1), slots(std::make_unique<Slot[]>(capacity)) {
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Returns false when the queue is full; the item is not enqueued.
+    bool tryPush(const T& item) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = item;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only.
+    bool tryPop(T& item) {
+        Slot& slot = slots[head & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != head + 1) {
+            return false;
+        }
+        item = slot.value;
+        slot.sequence.store(head + mask + 1, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+    // Approximate when producers are active; exact from the consumer when they are not.
+    size_t size() const {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        return currentTail > head ? currentTail - head : 0;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    alignas(64) size_t head = 0;
+};
+
+#endif // MPSC_QUEUE_H
@@ -1 +1,127 @@
 #pragma once
+#ifndef NETWORK_PROTOCOL_H
+#define NETWORK_PROTOCOL_H
+
+// Client-side view of the wire format shared with the server. Kept free of
+// rendering headers so headless tools can speak the protocol too.
+
+#include "packetSequence.h"
+#include "playerInput.h"
+#include "clockSync.h"
+#include <cstdint>
+
+#define SERVER_PORT 8080
+#define BUFFER_SIZE 256
+#define SNAPSHOT_HISTORY 32 // Snapshots kept as delta baselines, must match the server
+#define SERVER_TICK_INTERVAL (1.0 / 64.0) // Seconds per server tick, must match the server
+
+enum MessageType {
+    PlayerMovement = 0,
+    PlayerAttack = 1,
+    ChatMessage = 2,
+    heartBeat = 3,
+    ViewRadius = 4,
+    PlayerMovementDelta = 5,
+    Connect = 6,
+    ConnectAccepted = 7,
+    ClientUpdate = 8,
+    TimeSync = 9,
+};
+
+// A ClientUpdate payload is a 4-bit record count followed by that many
+// records, each a 2-bit UpdateRecord tag and its fields, packed with
+// BitWriter. Input is the newest input's server tick (32), a count
+// (INPUT_COUNT_BITS) and that many inputs of INPUT_BUTTON_BITS each for
+// consecutive ticks, oldest first and ending at the newest; see
+// playerInput.h. A view radius is one float as raw bits, chat an 8-bit
+// length and that many bytes, a time sync request our clock in wrapping
+// microseconds (32), answered with a TimeSync. A ClientUpdate with no
+// records is a keepalive that also carries our acks.
+enum UpdateRecord {
+    InputRecord = 0,
+    ViewRadiusRecord = 1,
+    ChatRecord = 2,
+    TimeSyncRecord = 3,
+};
+
+#define UPDATE_RECORD_TAG_BITS 2
+#define UPDATE_RECORD_COUNT_BITS 4
+#define CHAT_MESSAGE_MAX 200 // Longer chat messages are truncated
+#define CLIENT_KEEPALIVE_INTERVAL 1.0 // Seconds without anything to say before an update is sent anyway
+#define CLIENT_ACK_INTERVAL 0.0625 // Seconds an ack for new snapshot datagrams may wait for other traffic
+#define INPUT_HISTORY 64 // Inputs remembered with their predicted positions, for reconciliation
+#define PREDICTION_TOLERANCE 0.05f // World units our prediction may be off before it is corrected
+#define INPUT_MAX_LATE_TICKS 4 // Server ticks our input sampling may fall behind before it skips ahead
+#define INPUT_MAX_LOOKAHEAD 0.05 // Seconds ahead of its send time an input may be sampled, to cover one frame
+
+#define CONNECT_RETRY_INTERVAL 0.25 // Seconds between handshake attempts
+#define CONNECT_TIMEOUT 5.0 // Seconds to wait for the server to assign a slot
+
+// Every packet after the handshake names the slot and generation the server assigned
+struct OutGoingPacket {
+    PacketHeader header;
+    MessageType type;
+    uint16_t slot;
+    uint16_t generation;
+    uint32_t snapshotAck; // Newest snapshot tick fully received, the server's delta baseline
+    union {
+        struct {
+            float x, y;
+        } movementData;
+        struct {
+            int targetId;
+            int attackPower;
+        } attackData;
+        struct {
+            char message[BUFFER_SIZE - sizeof(PacketHeader) - sizeof(MessageType) - 2 * sizeof(uint16_t) - sizeof(uint32_t)];
+        } chatData;
+        struct {
+            bool alive;
+        } heartBeat;
+        struct {
+            float radius;
+        } viewData;
+        unsigned char records[BUFFER_SIZE - sizeof(PacketHeader) - sizeof(MessageType) - 2 * sizeof(uint16_t) - sizeof(uint32_t)];
+    };
+};
+
+struct PlayerPosition {
+    int playerId;
+    float x, y;
+};
+
+#define SNAPSHOT_MTU 1200 // Largest snapshot datagram the server sends, must match the server
+#define MAX_SNAPSHOT_PARTS 16 // Datagrams one snapshot may be split into, must match the server
+#define SNAPSHOT_REASSEMBLY_TIMEOUT 0.25 // Seconds an incomplete snapshot waits for its missing parts
+#define SNAPSHOT_ASSEMBLY_SLOTS 4 // Snapshots that may be reassembled at the same time
+#define SNAPSHOT_HEADER_SIZE (sizeof(PacketHeader) + sizeof(MessageType) + 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t))
+
+// Snapshot payloads are bit-packed, see bitstream.h and the encoders in server.cpp.
+// Large snapshots arrive as several parts that each decode on their own.
+struct IncomingPacket {
+    PacketHeader header;
+    MessageType type;
+    uint32_t tick;
+    uint32_t inputAck; // Newest of our inputs the server had applied when it took the snapshot
+    uint16_t partIndex;
+    uint16_t partCount;
+    union {
+        unsigned char payload[SNAPSHOT_MTU - SNAPSHOT_HEADER_SIZE];
+        struct {
+            char message[SNAPSHOT_MTU - SNAPSHOT_HEADER_SIZE];
+        } chatData;
+        struct {
+            uint16_t slot;
+            uint16_t generation;
+            float x, y; // Where the server spawned us
+        } connectData;
+        struct {
+            uint32_t requestedAt; // Echo of our time sync request
+            int64_t receivedAt;   // Server clock in microseconds when the request arrived
+            int64_t sentAt;       // Server clock when this reply was sent
+            int64_t tickStart;    // Server clock when tick started
+        } timeSyncData;
+    };
+};
+
+#endif // NETWORK_PROTOCOL_H
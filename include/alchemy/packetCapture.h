@@ -0,0 +1,80 @@
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include "socketPlatform.h"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#define CAPTURE_MAGIC "ALCHCAP6" // First eight bytes of every capture file
+#define CAPTURE_MAX_DATAGRAM 2048 // Longer datagrams are truncated when recorded
+
+// Capture file layout, little-endian as written by the host:
+//   magic (8 bytes), the server settings it was recorded with (CaptureSettings),
+//   then one record per inbound datagram:
+//   timestamp (uint64, nanoseconds since the capture started),
+//   tick (uint32, the last tick the server had published on arrival),
+//   IPv4 address and port (uint32 and uint16, network byte order as in sockaddr_in),
+//   length (uint16), then length bytes of datagram.
+
+#pragma pack(push, 1)
+// Server settings that change what the tick sends for the same datagrams, so a
+// replay runs with the ones the capture was recorded with
+struct CaptureSettings {
+    float spawnArea;
+    double snapshotRate;
+    double clientPacketRate;
+    double clientPacketBurst;
+    uint8_t adaptiveSendRate;
+};
+
+struct CaptureRecordHeader {
+    uint64_t timestamp;
+    uint32_t tick;
+    uint32_t address;
+    uint16_t port;
+    uint16_t length;
+};
+#pragma pack(pop)
+
+struct CapturedDatagram {
+    uint64_t timestamp; // Nanoseconds since the capture started
+    uint32_t tick;      // Drained by the tick after this one
+    sockaddr_in address;
+    int length;
+    unsigned char data[CAPTURE_MAX_DATAGRAM];
+};
+
+// Appends datagrams to a capture file. Safe to call from every receive
+// shard at once; records are serialized under a lock, so capturing costs
+// throughput and is meant for recording benchmark inputs, not production.
+class CaptureWriter {
+public:
+    CaptureWriter(const std::string& path, const CaptureSettings& settings);
+
+    void record(const sockaddr_in& address, const void* data, int length, std::chrono::steady_clock::time_point receivedAt, uint32_t tick);
+    void flush();
+
+private:
+    std::mutex mutex;
+    std::ofstream file;
+    std::chrono::steady_clock::time_point start;
+};
+
+class CaptureReader {
+public:
+    explicit CaptureReader(const std::string& path);
+
+    const CaptureSettings& settings() const;
+
+    // False at the end of the file or on a truncated record
+    bool next(CapturedDatagram& datagram);
+
+private:
+    std::ifstream file;
+    CaptureSettings recordedSettings;
+};
+
+#endif // PACKET_CAPTURE_H
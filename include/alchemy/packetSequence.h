@@ -0,0 +1,207 @@
+#ifndef PACKET_SEQUENCE_H
+#define PACKET_SEQUENCE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#define ACK_BITS 32 // Packets before the newest one that every ack also vouches for
+#define SENT_PACKET_HISTORY 256 // Sent packets remembered per connection until acked or lost, power of two
+#define RTT_SMOOTHING 0.125 // Weight of each new sample in the smoothed round trip time
+#define ACK_DELAY_UNIT_US 16 // Resolution of PacketHeader::ackDelay, so 16 bits cover a second
+
+// Leads every datagram in both directions. sequence counts the sender's
+// packets, ack is the newest sequence it has received from the peer and bit n
+// of ackBits stands for sequence ack - 1 - n. Acks ride on traffic that is
+// sent anyway, so a lost ack is repeated by the next 32 packets for free.
+// Sequence 0 is never sent, so an ack of 0 means nothing has arrived yet and
+// handshake packets, which are not sequenced, simply carry a zeroed header.
+//
+// ackDelay is how long the sender held ack before this packet carried it, so
+// the peer can take it out of its round trip time: a client that is not
+// moving only acks every CLIENT_ACK_INTERVAL.
+struct PacketHeader {
+    uint16_t sequence;
+    uint16_t ack;
+    uint32_t ackBits;
+    uint16_t ackDelay; // In ACK_DELAY_UNIT_US
+};
+
+// Encodes the time since the packet ack names arrived, saturating at the field's range
+inline uint16_t encodeAckDelay(std::chrono::steady_clock::duration held) {
+    int64_t units = std::chrono::duration_cast<std::chrono::microseconds>(held).count() / ACK_DELAY_UNIT_US;
+    return static_cast<uint16_t>(std::clamp<int64_t>(units, 0, UINT16_MAX));
+}
+
+// True if sequence a was sent after b, across wraparound
+inline bool sequenceNewer(uint16_t a, uint16_t b) {
+    return static_cast<int16_t>(static_cast<uint16_t>(a - b)) > 0;
+}
+
+// The sequence sent after this one, skipping 0 on wraparound
+inline uint16_t nextSequence(uint16_t sequence) {
+    uint16_t next = static_cast<uint16_t>(sequence + 1);
+    return next == 0 ? 1 : next;
+}
+
+// Receive side of one connection: classifies each arriving sequence and
+// produces the ack fields for the packets sent back.
+class ReceiveWindow {
+public:
+    enum Order {
+        Newest,    // Newer than anything received so far
+        Late,      // Overtaken by a newer packet but not seen before
+        Duplicate, // Already received, or too old to tell
+    };
+
+    Order receive(uint16_t sequence) {
+        if (!started) {
+            started = true;
+            newest = sequence;
+            bits = 0;
+            return Newest;
+        }
+
+        if (sequenceNewer(sequence, newest)) {
+            uint16_t distance = static_cast<uint16_t>(sequence - newest);
+            // The previous newest becomes bit distance - 1
+            bits = distance > ACK_BITS ? 0 : ((static_cast<uint64_t>(bits) << distance) | (1ull << (distance - 1)));
+            newest = sequence;
+            return Newest;
+        }
+
+        uint16_t age = static_cast<uint16_t>(newest - sequence);
+        if (age == 0 || age > ACK_BITS || (bits & (1u << (age - 1))) != 0) {
+            return Duplicate;
+        }
+        bits |= 1u << (age - 1);
+        return Late;
+    }
+
+    void reset() {
+        started = false;
+        newest = 0;
+        bits = 0;
+    }
+
+    uint16_t ack() const { return newest; }
+    uint32_t ackBits() const { return bits; }
+
+private:
+    bool started = false;
+    uint16_t newest = 0;
+    uint32_t bits = 0;
+};
+
+// Send side of one connection: numbers outgoing packets and turns the peer's
+// acks into round trip times and loss. A packet counts as lost once it falls
+// out of the ack window without having been acked.
+class AckTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Sequence for the next packet, remembered as sent now
+    uint16_t send(Clock::time_point now) {
+        uint16_t sequence = next;
+        next = nextSequence(next);
+        SentPacket& packet = sent[sequence & (SENT_PACKET_HISTORY - 1)];
+        packet.sequence = sequence;
+        packet.acked = false;
+        packet.valid = true;
+        packet.sentAt = now;
+        packetsSent++;
+        return sequence;
+    }
+
+    // Applies the ack fields of a packet received at receivedAt. Safe to call
+    // again with the same ack. Returns true if it produced a new RTT sample.
+    bool acknowledge(uint16_t ack, uint32_t ackBits, uint16_t ackDelay, Clock::time_point receivedAt) {
+        if (ack == 0 || packetsSent == 0 || !sequenceNewer(next, ack)) {
+            return false; // Acks something we never sent
+        }
+
+        bool sampled = false;
+        for (int n = 0; n <= ACK_BITS; ++n) {
+            if (n > 0 && (ackBits & (1u << (n - 1))) == 0) {
+                continue;
+            }
+            uint16_t sequence = static_cast<uint16_t>(ack - n);
+            SentPacket& packet = sent[sequence & (SENT_PACKET_HISTORY - 1)];
+            if (!packet.valid || packet.sequence != sequence || packet.acked) {
+                continue;
+            }
+            packet.acked = true;
+            packetsAcked++;
+
+            // Only the newest ack's hold time is known; older bits may be repeats of lost acks.
+            // A hold longer than the whole round trip can only be garbage, so it is not taken out.
+            if (n == 0 && receivedAt >= packet.sentAt) {
+                latestRtt = receivedAt - packet.sentAt;
+                Clock::duration held = std::chrono::microseconds(static_cast<int64_t>(ackDelay) * ACK_DELAY_UNIT_US);
+                if (held < latestRtt) {
+                    latestRtt -= held;
+                }
+                double sample = std::chrono::duration<double>(latestRtt).count();
+                smoothedRtt = smoothedRtt == 0.0 ? sample : smoothedRtt + RTT_SMOOTHING * (sample - smoothedRtt);
+                sampled = true;
+            }
+        }
+
+        // Everything older than the window is settled now: acked by now or never
+        uint16_t windowStart = static_cast<uint16_t>(ack - ACK_BITS);
+        for (int settled = 0; sequenceNewer(windowStart, oldestUnsettled) && settled < SENT_PACKET_HISTORY; ++settled) {
+            SentPacket& packet = sent[oldestUnsettled & (SENT_PACKET_HISTORY - 1)];
+            if (packet.valid && packet.sequence == oldestUnsettled && !packet.acked) {
+                packetsLost++;
+            }
+            oldestUnsettled++;
+        }
+        if (sequenceNewer(windowStart, oldestUnsettled)) {
+            oldestUnsettled = windowStart;
+        }
+        return sampled;
+    }
+
+    void reset() {
+        for (SentPacket& packet : sent) {
+            packet.valid = false;
+        }
+        next = 1;
+        oldestUnsettled = 1;
+        packetsSent = packetsAcked = packetsLost = 0;
+        smoothedRtt = 0.0;
+        latestRtt = Clock::duration::zero();
+    }
+
+    Clock::duration lastRtt() const { return latestRtt; }
+    double rtt() const { return smoothedRtt; } // Seconds, 0 until the first sample
+
+    uint64_t sentCount() const { return packetsSent; }
+    uint64_t ackedCount() const { return packetsAcked; }
+    uint64_t lostCount() const { return packetsLost; }
+
+    // Fraction of settled packets that were lost
+    double loss() const {
+        uint64_t settled = packetsAcked + packetsLost;
+        return settled == 0 ? 0.0 : static_cast<double>(packetsLost) / settled;
+    }
+
+private:
+    struct SentPacket {
+        uint16_t sequence = 0;
+        bool acked = false;
+        bool valid = false;
+        Clock::time_point sentAt;
+    };
+
+    SentPacket sent[SENT_PACKET_HISTORY];
+    uint16_t next = 1;
+    uint16_t oldestUnsettled = 1;
+    uint64_t packetsSent = 0;
+    uint64_t packetsAcked = 0;
+    uint64_t packetsLost = 0;
+    double smoothedRtt = 0.0;
+    Clock::duration latestRtt = Clock::duration::zero();
+};
+
+#endif // PACKET_SEQUENCE_H
@@ -0,0 +1,46 @@
+#ifndef PLAYER_INPUT_H
+#define PLAYER_INPUT_H
+
+#include <cstdint>
+
+// Input commands shared by the client, the server and the load generator.
+// Clients send which buttons were held on each of their ticks, not where
+// they ended up. The server runs applyPlayerInput on its own copy of the
+// player, so movement is authoritative, and the client runs the same step to
+// predict its own position without waiting for a round trip.
+//
+// Each input is stamped with the server tick it should be applied on, see
+// clockSync.h and inputBuffer.h. An idle client stops producing them.
+
+enum InputButton : uint8_t {
+    InputUp = 1 << 0,
+    InputDown = 1 << 1,
+    InputLeft = 1 << 2,
+    InputRight = 1 << 3,
+    InputAttack = 1 << 4,
+    InputInteract = 1 << 5,
+};
+
+#define INPUT_BUTTON_BITS 6 // Width of one input on the wire
+#define INPUT_COUNT_BITS 4 // Width of the input count in an input record
+#define INPUT_REDUNDANCY 8 // Newest unacknowledged inputs repeated in every update, below 1 << INPUT_COUNT_BITS
+#define PLAYER_STEP 0.1f // World units moved per input along each held axis, one input per server tick
+
+// Advances a player by one input. Opposing buttons cancel and diagonals are
+// not normalized, matching how the client has always moved.
+inline void applyPlayerInput(uint8_t buttons, float& x, float& y) {
+    if (buttons & InputUp) {
+        y += PLAYER_STEP;
+    }
+    if (buttons & InputDown) {
+        y -= PLAYER_STEP;
+    }
+    if (buttons & InputLeft) {
+        x -= PLAYER_STEP;
+    }
+    if (buttons & InputRight) {
+        x += PLAYER_STEP;
+    }
+}
+
+#endif // PLAYER_INPUT_H
@@ -0,0 +1,63 @@
+#ifndef PLAYER_TABLE_H
+#define PLAYER_TABLE_H
+
+#include <alchemy/socketPlatform.h>
+#include <alchemy/packetSequence.h>
+#include <alchemy/inputBuffer.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-player server state in structure-of-arrays form, indexed by a dense
+// slot handed out when a client connects. Each column holds one field for
+// every slot in [0, highWater()), so per-tick sweeps walk contiguous arrays
+// and skip free slots with the live column.
+//
+// This is the server's session pool: together with the EndpointTable that
+// maps source addresses to slots it holds everything the tick knows about a
+// connection, and releasing a slot ends the session completely.
+//
+// A slot's generation is bumped every time it is released. Clients echo
+// their slot and generation in every packet, so a stale packet from a
+// departed player can never touch whoever was given the slot next.
+//
+// Not thread-safe: owned by the tick thread.
+class PlayerTable {
+public:
+    explicit PlayerTable(int capacity);
+
+    // Returns the new slot, or -1 when every slot is taken
+    int allocate(const sockaddr_in& clientAddr, std::chrono::steady_clock::time_point now);
+    void release(int slot);
+
+    bool isLive(int slot, uint16_t generation) const;
+    int highWater() const;
+    size_t size() const;
+
+    std::vector<uint8_t> live;
+    std::vector<uint16_t> generation;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> viewRadius;
+    std::vector<uint32_t> ackedTick;
+    std::vector<std::chrono::steady_clock::time_point> lastKeepAlive;
+    std::vector<sockaddr_in> address;
+    std::vector<uint64_t> heartbeatTimer; // TimerWheel id of the pending heartbeat check
+    std::vector<ReceiveWindow> receiveWindow; // Sequences received from the client
+    std::vector<InputBuffer> inputs; // Inputs received and not yet simulated
+    std::vector<uint16_t> peerAck; // Ack fields of the newest packet received, echoed to the send thread
+    std::vector<uint32_t> peerAckBits;
+    std::vector<uint16_t> peerAckDelay;
+    std::vector<std::chrono::steady_clock::time_point> peerAckAt;
+    std::vector<std::chrono::steady_clock::time_point> connectedAt;
+    std::vector<uint64_t> packetsReceived; // Packets that reached this session, rejected ones included
+    std::vector<uint64_t> packetsRejected; // Late or duplicate
+
+private:
+    int capacity;
+    size_t liveCount;
+    std::vector<int> freeSlots; // Min-heap, the lowest free slot is reused first so live slots stay packed
+};
+
+#endif // PLAYER_TABLE_H
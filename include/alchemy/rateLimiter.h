@@ -0,0 +1,56 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <alchemy/socketPlatform.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#define RATE_LIMITER_PROBES 8 // Table entries searched for an address before one is evicted
+
+// Per-source-address token buckets, checked for every datagram before it is
+// decoded. Each address earns `rate` packets per second and may save up to
+// `burst` of them, so a client sending at its normal cadence never notices
+// while a flood from one address is cut down to the refill rate.
+//
+// Buckets live in a fixed open-addressing table with short linear probes.
+// A bucket left alone long enough to refill completely holds no state worth
+// keeping and is reused in place; when every probed bucket is active the
+// least recently seen one is evicted and its address starts over with a
+// full bucket. The table therefore never allocates after construction, and
+// spoofed source addresses can cost a real client its history but never
+// grow memory.
+//
+// Not thread-safe: one per receive shard. The kernel steers each address to
+// a single shard, so no bucket is ever split across threads.
+class RateLimiter {
+public:
+    // rate <= 0 disables limiting; capacity is rounded up to a power of two
+    RateLimiter(double rate, double burst, int capacity);
+
+    // Takes one token for the address, returns false if it had none
+    bool allow(const sockaddr_in& address, std::chrono::steady_clock::time_point now);
+
+    bool enabled() const;
+    uint64_t evictions() const;
+
+private:
+    struct Bucket {
+        uint32_t ip = 0;
+        uint16_t port = 0;
+        bool used = false;
+        float tokens = 0.0f;
+        int64_t lastSeen = 0; // steady_clock nanoseconds
+    };
+
+    size_t home(uint32_t ip, uint16_t port) const;
+
+    std::vector<Bucket> buckets;
+    size_t mask;
+    double rate;
+    float burst;
+    int64_t idleNanos; // Time for an empty bucket to refill completely
+    uint64_t evicted;
+};
+
+#endif // RATE_LIMITER_H
@@ -1,31 +1,90 @@
 #ifndef SERVER_H
 #define SERVER_H
 
-#include <winsock2.h>       
-#include <ws2tcpip.h>         
+#include "socketPlatform.h"
+#include "broadcastEngine.h"
+#include "mpscQueue.h"
+#include "tripleBuffer.h"
+#include "spatialGrid.h"
+#include "bitstream.h"
+#include "playerTable.h"
+#include "timerWheel.h"
+#include "logger.h"
+#include "tickScheduler.h"
+#include "metrics.h"
+#include "packetCapture.h"
+#include "packetSequence.h"
+#include "rateLimiter.h"
+#include "endpointTable.h"
+#include "congestionControl.h"
+#include "playerInput.h"
 #include <iostream>         
-#include <unordered_map>      
-#include <unordered_set>      
 #include <string>            
 #include <functional>         
 #include <chrono>          
 #include <thread>         
-#include <mutex>             
 #include <queue>               
 #include <cstring>   
-#include <ws2tcpip.h>
-#include <chrono>
-
-#pragma comment(lib, "Ws2_32.lib")
+#include <atomic>
+#include <system_error>
+#include <memory>
+#include <vector>
+#include <random>
 
 #define SERVER_PORT 8080
 #define BUFFER_SIZE 1024
 
 #define HEARTBEAT_TIMEOUT 5.0 // Timeout in seconds
 
+#define RECV_BATCH_SIZE 64 // Datagrams pulled per recvmmsg call
+#define STATS_INTERVAL 5.0 // Seconds between network stats reports
+#define IDLE_TICK_RATE 4.0 // Ticks per second while no clients are connected
+#define METRICS_PORT 9464 // Loopback port serving Prometheus text, 0 to disable
+#define METRICS_FILE_INTERVAL 10.0 // Seconds between metrics file rewrites when a file is configured
+#define INBOUND_QUEUE_CAPACITY 16384 // Decoded commands buffered between receivers and the tick, power of two
+#define AOI_CELL_SIZE 16.0f       // Spatial grid cell edge in world units
+#define DEFAULT_VIEW_RADIUS 30.0f // Used until a client reports its camera view
+#define MAX_VIEW_RADIUS 250.0f    // Cap on what a client may ask to see
+#define BROADCAST_USE_GSO true // Merge same-client datagrams with UDP_SEGMENT where supported
+#define SNAPSHOT_HISTORY 32 // Snapshots remembered per client as delta baselines
+#define SNAPSHOT_MTU 1200 // Byte budget for one snapshot datagram
+#define POSITION_FRACTION_BITS 6 // Snapshot position precision, 1/64 world unit
+#define MAX_VISIBLE_PLAYERS 2048 // Nearest players replicated to one client, few enough for a full snapshot to always fit
+#define MAX_SNAPSHOT_PARTS 16 // Datagrams one snapshot may be split into, below 32
+#define SNAPSHOT_ENTRY_MAX_BITS (3 * 8 + 2 * 16) // Largest full snapshot entry: a 3-byte id varint and two 16-bit offsets
+#define MAX_PLAYER_SLOTS 16384 // Concurrent players, slots travel as 16-bit ids
+#define UPDATE_RECORD_COUNT_BITS 4 // ClientUpdate record count width, must match the client
+#define UPDATE_RECORD_TAG_BITS 2 // ClientUpdate record tag width, must match the client
+#define CLIENT_PACKET_RATE 256.0 // Packets per second one source address may sustain, 0 to disable
+#define CLIENT_PACKET_BURST 64.0 // Packets one source address may send back to back
+#define RATE_LIMITER_CAPACITY 32768 // Token buckets per receive shard
+#define SPAWN_SEED 1 // Seeds spawn points, fixed so a replay spawns everyone where they were
+
+enum NetworkBackend {
+    ClassicBackend, // epoll + recvmmsg receive, sendmmsg broadcast (blocking recvfrom/sendto off Linux)
+    IoUringBackend, // Multishot io_uring receive into provided buffers, io_uring batched sends (Linux 6.0+)
+};
+
+struct ServerConfig {
+    NetworkBackend backend = ClassicBackend; // Falls back to classic where io_uring is unavailable
+    int receiveShards = 1;         // SO_REUSEPORT sockets, each with its own receiver thread (Linux only)
+    bool pinReceiveThreads = true; // Pin each receiver thread to its own core
+    double clientPacketRate = CLIENT_PACKET_RATE;
+    double clientPacketBurst = CLIENT_PACKET_BURST;
+    int metricsPort = METRICS_PORT;
+    std::string metricsFile;       // Also dump metrics here when set
+    double metricsFileInterval = METRICS_FILE_INTERVAL;
+    bool adaptiveSendRate = true;  // Pace each client's snapshots to its measured loss and RTT
+    double snapshotRate = 64.0;    // Snapshots per second each client is sent at most, rounded to whole ticks
+    float spawnArea = 0.0f;        // New players spawn at random in [0, spawnArea) on both axes, at the origin when 0
+    std::string capturePath;       // Record every inbound datagram here when set
+    std::string replayPath;        // Feed this capture through the tick instead of opening sockets
+    bool replayRealTime = false;   // Replay at the captured pacing rather than as fast as possible
+};
+
 class Server {
 public:
-    Server();
+    Server(const ServerConfig& config = ServerConfig());
     ~Server();
     void run();
 
@@ -35,20 +94,34 @@ private:
         PlayerAttack = 1,
         ChatMessage = 2,
         heartBeat = 3,
+        ViewRadius = 4,
+        PlayerMovementDelta = 5,
+        Connect = 6,
+        ConnectAccepted = 7,
+        ClientUpdate = 8,
+        TimeSync = 9,
     };
 
-    struct PlayerInfo {
-        float x;
-        float y;
-        std::chrono::steady_clock::time_point lastKeepAlive;
+    // Records inside a ClientUpdate, see network_protocol.h for the layout
+    enum UpdateRecord {
+        InputRecord = 0,
+        ViewRadiusRecord = 1,
+        ChatRecord = 2,
+        TimeSyncRecord = 3,
+    };
 
-        PlayerInfo(float x = 0.0f, float y = 0.0f)
-            : x(x), y(y), lastKeepAlive(std::chrono::steady_clock::now()) {}
+    // What a TimerWheel entry means; target and data are interpreted per kind
+    enum TimerKind {
+        HeartbeatTimer = 0, // target = slot, data = slot generation
     };
 
+    // Every packet after the handshake names the slot and generation the server assigned
     struct IncomingPacket {
+        PacketHeader header;
         MessageType type;
-        int clientId;
+        uint16_t slot;
+        uint16_t generation;
+        uint32_t snapshotAck; // Newest snapshot tick the client has fully received
         union {
             struct {
                 float x, y;
@@ -58,13 +131,43 @@ private:
                 int attackPower;
             } attackData;
             struct {
-                char message[BUFFER_SIZE - sizeof(MessageType) - sizeof(int)];
+                char message[BUFFER_SIZE - sizeof(PacketHeader) - sizeof(MessageType) - 2 * sizeof(uint16_t) - sizeof(uint32_t)];
             } chatData;
             struct
             {
                 bool alive;
             } heartBeat;
+            struct {
+                float radius;
+            } viewData;
+            unsigned char records[BUFFER_SIZE - sizeof(PacketHeader) - sizeof(MessageType) - 2 * sizeof(uint16_t) - sizeof(uint32_t)];
+        };
+    };
+
+    // What a receiver thread hands to the tick after decoding a datagram.
+    // An Update carries whichever of inputs, view radius and time sync
+    // request the datagram held; one with none is a heartbeat.
+    struct InboundCommand {
+        enum Kind {
+            Update,
+            Disconnect,
+            Connect,
         };
+
+        Kind kind;
+        PacketHeader header;
+        uint16_t slot;
+        uint16_t generation;
+        uint32_t snapshotAck;
+        uint32_t inputTick; // Server tick inputs[inputCount - 1] is stamped for, the rest count down from it
+        uint8_t inputCount;
+        uint8_t inputs[INPUT_REDUNDANCY];
+        bool hasViewRadius;
+        float viewRadius;
+        bool hasTimeSync;
+        uint32_t syncRequestedAt; // The client's clock, echoed back untouched
+        sockaddr_in clientAddr;
+        std::chrono::steady_clock::time_point receivedAt;
     };
 
     struct PlayerPositionAndPlayer {
@@ -72,30 +175,101 @@ private:
         float x, y;
     };
 
-#define MAX_PLAYERS (BUFFER_SIZE - sizeof(MessageType) - sizeof(int)) / sizeof(PlayerPositionAndPlayer)
+    // One client's slice of WorldSnapshot::visible, sorted by player id
+    struct ClientView {
+        sockaddr_in address;
+        int slot;
+        uint16_t generation;
+        size_t firstVisible;
+        size_t visibleCount;
+        uint32_t ackedTick;
+        uint32_t inputAck; // Newest of the client's inputs applied
+        uint16_t ack;     // Newest sequence received from the client, stamped on what we send it
+        uint32_t ackBits;
+        uint16_t peerAck; // The client's latest ack of our datagrams, 0 until it has one
+        uint32_t peerAckBits;
+        uint16_t peerAckDelay;
+        std::chrono::steady_clock::time_point peerAckAt; // Also when the packet ack names arrived
+    };
+
+    // A player that moved since the baseline, as a step in quantized position units
+    struct PositionStep {
+        int playerId;
+        int32_t dx, dy;
+    };
+
+    // What one client was sent for one tick, kept so later ticks can be encoded against it
+    struct SentSnapshot {
+        uint32_t tick = 0;
+        std::vector<PlayerPositionAndPlayer> players;
+    };
+
+    // The send side of a session, indexed by slot. Reset when the slot's
+    // generation changes hands and emptied once the slot is no longer live.
+    struct ClientHistory {
+        SentSnapshot ring[SNAPSHOT_HISTORY];
+        AckTracker acks; // Sequences our datagrams to the client, and its RTT and loss
+        CongestionController pacing;
+        uint16_t generation = 0;
+        bool active = false;
+    };
+
+    // A handshake reply the send thread owes a newly connected client
+    struct ConnectReply {
+        sockaddr_in address;
+        uint16_t slot;
+        uint16_t generation;
+        float x, y;
+    };
+
+    // A time sync reply the send thread owes a client, see clockSync.h
+    struct TimeSyncReply {
+        sockaddr_in address;
+        uint32_t requestedAt;
+        std::chrono::steady_clock::time_point receivedAt;
+    };
 
+    // Immutable copy of the state a tick wants broadcast, handed to the send thread.
+    // Each client only gets the players inside its view radius.
+    struct WorldSnapshot {
+        uint64_t tick = 0;
+        std::chrono::steady_clock::time_point tickStart; // The tick's deadline, which clients align their inputs to
+        std::vector<PlayerPositionAndPlayer> visible;
+        std::vector<ClientView> clients;
+        std::vector<ConnectReply> accepted;
+        std::vector<TimeSyncReply> timeSyncs;
+    };
+
+#define SNAPSHOT_HEADER_SIZE (sizeof(PacketHeader) + sizeof(MessageType) + 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t))
+
+    // Snapshot payloads are bit-packed (see encodeFullSnapshot and encodeDelta).
+    // A snapshot too large for one datagram is split into parts that each decode on their own.
     struct OutgoingPacket {
+        PacketHeader header;
         MessageType type;
+        uint32_t tick;
+        uint32_t inputAck; // Per client, so stamped by the send loop rather than the encoders
+        uint16_t partIndex;
+        uint16_t partCount;
         union {
+            unsigned char payload[SNAPSHOT_MTU - SNAPSHOT_HEADER_SIZE];
             struct {
-                int numPlayers;
-                PlayerPositionAndPlayer players[MAX_PLAYERS];
-            } movementUpdates;
-            struct {
-                char message[BUFFER_SIZE - sizeof(MessageType)];
+                char message[SNAPSHOT_MTU - SNAPSHOT_HEADER_SIZE];
             } chatData;
+            struct {
+                uint16_t slot;
+                uint16_t generation;
+                float x, y;
+            } connectData;
+            struct {
+                uint32_t requestedAt;
+                int64_t receivedAt; // Our clock in microseconds, see serverMicros
+                int64_t sentAt;
+                int64_t tickStart;
+            } timeSyncData;
         };
     };
 
-    struct sockaddr_in_hash {
-        std::size_t operator()(const sockaddr_in& addr) const {
-            std::size_t h1 = std::hash<int>()(addr.sin_family);
-            std::size_t h2 = std::hash<int>()(addr.sin_port);
-            std::size_t h3 = std::hash<int>()(addr.sin_addr.s_addr);
-            return h1 ^ (h2 << 1) ^ (h3 << 1);
-        }
-    };
-
     struct sockaddr_in_equal {
         bool operator()(const sockaddr_in& lhs, const sockaddr_in& rhs) const {
             return lhs.sin_family == rhs.sin_family &&
@@ -105,21 +279,181 @@ private:
     };
 
     void initializeWinSock();
-    void createSocket();
-    void bindSocket();
-    void receiveData();
+    SOCKET createSocket();
+    void bindSocket(SOCKET socket);
+    void receiveData(int shard);
+#ifdef __linux__
+    void receiveDataBatched(int shard);
+#ifdef HAS_IO_URING
+    bool receiveDataIoUring(int shard);
+#endif
+    void pinReceiveThread(int shard);
+#endif
+    void runReplay();
+    CaptureSettings captureSettings() const;
+    void applyCaptureSettings(const CaptureSettings& settings);
+    std::chrono::steady_clock::time_point gameClock() const;
+    // The clock time sync replies carry; only differences and offsets mean anything to clients
+    static int64_t serverMicros(std::chrono::steady_clock::time_point time);
+    void reportNetworkStats();
+    void handleDatagram(int shard, const IncomingPacket& packet, int length, const sockaddr_in& clientAddr,
+        std::chrono::steady_clock::time_point receivedAt);
+    bool decodePacket(const IncomingPacket& packet, int length, const sockaddr_in& clientAddr,
+        std::chrono::steady_clock::time_point receivedAt, InboundCommand& command) const;
+    bool decodeUpdateRecords(const IncomingPacket& packet, size_t recordBytes, InboundCommand& command) const;
+    void enqueueCommand(const InboundCommand& command, int shard);
+    void drainInboundCommands();
+    void handleClientConnect(const InboundCommand& command);
     void handleClientDisconnect(const sockaddr_in& clientAddr);
-    void checkHeartbeats();
-    void processIncomingPacket(const IncomingPacket& packet, const sockaddr_in& clientAddr);
-    void sendMovementUpdates();
+    void removePlayer(int slot);
+    void processTimers();
+    void onHeartbeatTimer(int slot, uint16_t generation);
+    void scheduleHeartbeat(int slot, double seconds);
+    void processIncomingPacket(const InboundCommand& command);
+    void simulatePlayers();
+    void publishSnapshot();
+    void sendLoop();
+    void sendMovementUpdates(const WorldSnapshot& snapshot);
+    void flushBroadcast();
+    void releaseClientHistories(size_t firstSlot, size_t endSlot);
+    int encodeFullSnapshot(uint32_t tick, const PlayerPositionAndPlayer* players, size_t playerCount,
+        std::vector<PlayerPositionAndPlayer>& sent);
+    int encodeDelta(uint32_t tick, const SentSnapshot& baseline, const PlayerPositionAndPlayer* players, size_t playerCount,
+        std::vector<PlayerPositionAndPlayer>& sent);
+
+    // Registered once at startup; see the constructor for names and units
+    struct ServerMetrics {
+        explicit ServerMetrics(MetricsRegistry& registry);
+
+        Histogram& tickDuration;
+        Histogram& tickLateness;
+        Histogram& sendDuration;
+        Histogram& commandLatency;
+        Counter& packetsReceived;
+        Counter& bytesReceived;
+        Counter& packetsSent;
+        Counter& bytesSent;
+        Counter& commandsDropped;
+        Counter& packetsRateLimited;
+        Counter& packetsMalformed;
+        Counter& snapshotsSkipped;
+        Counter& snapshotsDeferred;
+        Counter& snapshotEntriesDropped;
+        Counter& packetsRejected;
+        Counter& packetsAcked;
+        Counter& packetsLost;
+        Counter& inputsApplied;
+        Counter& inputsLate;
+        Histogram& clientRtt;
+        Gauge& connectedClients;
+        Gauge& clientsSendLimited;
+        Gauge& inboundQueueDepth;
+        Gauge& timersPending;
+    };
 
-    SOCKET serverSocket;
+    ServerConfig config;
+    MetricsRegistry metricsRegistry;
+    ServerMetrics metrics{ metricsRegistry };
+    std::unique_ptr<MetricsExporter> metricsExporter;
+    std::unique_ptr<CaptureWriter> capture;
+    std::unique_ptr<CaptureReader> replayReader;
+    // During replay game time follows the capture's timeline, not the wall clock
+    bool replaying = false;
+    std::chrono::steady_clock::time_point replayTime;
+    SOCKET serverSocket; // Shard 0, also used for all sends
+    std::vector<SOCKET> receiveSockets;
     sockaddr_in serverAddr;
-    std::unordered_set<sockaddr_in, sockaddr_in_hash, sockaddr_in_equal> clients;
-    std::unordered_map<int, PlayerInfo> playerPositions;
-    std::mutex mutex;
-    std::thread receiverThread;
+    PlayerTable playerTable{ MAX_PLAYER_SLOTS };
+    // Only consulted by connect and disconnect, never per packet
+    EndpointTable slotsByAddress{ MAX_PLAYER_SLOTS };
+    std::mt19937 spawnRng{ SPAWN_SEED };
+    std::vector<ConnectReply> pendingAccepts;
+    std::vector<TimeSyncReply> pendingTimeSyncs;
+    TimerWheel timers;
+    std::vector<TimerWheel::FiredTimer> firedTimers;
+    SpatialGrid grid{ AOI_CELL_SIZE };
+    std::vector<int> interestScratch;
+    // Receivers only push here; playerTable and the grid belong to the tick thread
+    MpscQueue<InboundCommand> inboundCommands{ INBOUND_QUEUE_CAPACITY };
+    std::vector<std::thread> receiverThreads;
+    std::thread senderThread;
     const double tickRate = 1.0 / 64.0;
+    TickScheduler tickScheduler{ tickRate };
+    uint64_t snapshotStride = 1; // Ticks between snapshots, from config.snapshotRate
+
+#ifdef __linux__
+    // Preallocated slots recvmmsg fills in place, reused for every batch
+    struct ReceiveRing {
+        IncomingPacket packets[RECV_BATCH_SIZE];
+        sockaddr_in addrs[RECV_BATCH_SIZE];
+        iovec iovecs[RECV_BATCH_SIZE];
+        mmsghdr headers[RECV_BATCH_SIZE];
+    };
+
+    std::vector<int> epollFds;
+#endif
+
+    // Receive counters, written by each shard's receiver thread and read by the tick
+    struct alignas(64) ReceiveShardStats {
+        std::atomic<uint64_t> wakeups{ 0 };
+        std::atomic<uint64_t> datagrams{ 0 };
+        std::atomic<uint64_t> maxPerWakeup{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+        std::atomic<uint64_t> rateLimited{ 0 };
+        std::atomic<uint64_t> malformed{ 0 };
+    };
+
+    std::unique_ptr<ReceiveShardStats[]> shardStats;
+    std::vector<RateLimiter> rateLimiters; // One per shard, touched only by its receiver thread
+    std::chrono::steady_clock::time_point lastStatsReport;
+
+    // Inbound queue counters, tick thread only
+    uint64_t drainedCommands = 0;
+    size_t maxQueueDepth = 0;
+    double drainLatencyTotal = 0.0;
+    double drainLatencyMax = 0.0;
+    uint64_t latePackets = 0;      // Overtaken by a newer packet from the same client
+    uint64_t duplicatePackets = 0; // Already seen, or older than the receive window
+    uint64_t inputsApplied = 0;
+    uint64_t inputsLate = 0;
+
+    // The tick publishes, the send thread serializes and transmits
+    TripleBuffer<WorldSnapshot> snapshots;
+    std::atomic<uint64_t> publishedTick{ 0 };
+    uint64_t tickCount = 0;
+    std::chrono::steady_clock::time_point tickStartedAt;
+
+    // Tick timing and timer counters, tick thread only
+    uint64_t ticksSinceReport = 0;
+    uint64_t timersFired = 0;
+    size_t timersFiredMax = 0;
+    double tickDurationTotal = 0.0;
+    double tickDurationMax = 0.0;
+
+    // Broadcast counters, written by the send thread
+    std::unique_ptr<BroadcastEngine> broadcaster;
+    std::atomic<uint64_t> broadcastTicks{ 0 };
+    std::atomic<uint64_t> broadcastSyscalls{ 0 };
+    std::atomic<uint64_t> broadcastBytes{ 0 };
+    std::atomic<uint64_t> snapshotsSkipped{ 0 };
+    std::atomic<uint64_t> fullSnapshotsSent{ 0 };
+    std::atomic<uint64_t> deltaSnapshotsSent{ 0 };
+    std::atomic<uint64_t> snapshotPartsSent{ 0 };
+    std::atomic<uint64_t> snapshotsDeferred{ 0 };
+    std::atomic<uint64_t> datagramsAcked{ 0 };
+    std::atomic<uint64_t> datagramsLost{ 0 };
+    std::atomic<uint64_t> rttSamples{ 0 };
+    std::atomic<uint64_t> rttTotalMicros{ 0 };
+
+    // Per-client baselines indexed by slot, send thread only
+    std::vector<ClientHistory> clientHistories;
+    uint64_t lastSnapshotTick = 0;
+    std::vector<PlayerPositionAndPlayer> deltaAdded;
+    std::vector<PositionStep> deltaChanged;
+    std::vector<int> deltaRemoved;
+    std::vector<PlayerPositionAndPlayer> encodedPlayers;
+    OutgoingPacket fragments[MAX_SNAPSHOT_PARTS];
+    int fragmentSizes[MAX_SNAPSHOT_PARTS];
 };
 
 #endif // SERVER_H
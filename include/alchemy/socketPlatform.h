@@ -0,0 +1,44 @@
+#ifndef SOCKET_PLATFORM_H
+#define SOCKET_PLATFORM_H
+
+// Winsock and POSIX sockets behind one set of names so server code can use
+// SOCKET, INVALID_SOCKET, SOCKET_ERROR and closesocket on every platform.
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define closesocket close
+#endif
+
+inline int lastSocketError() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+// Mixes an IPv4 address and port, both in network byte order, into a table index
+inline size_t hashEndpoint(uint32_t ip, uint16_t port) {
+    uint64_t key = (static_cast<uint64_t>(ip) << 16) | port;
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+#endif // SOCKET_PLATFORM_H
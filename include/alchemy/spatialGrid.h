@@ -0,0 +1,50 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Hashed uniform grid over entity positions for area-of-interest queries.
+// Cells are created on demand, so the world needs no fixed bounds. Moving an
+// entity only touches the grid when it crosses into a different cell, and
+// removal swaps the entity out of its cell in O(1).
+//
+// Ids are PlayerTable slots: entries are a column indexed by id that grows to
+// the highest id inserted, so a query looks positions up without hashing.
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cellSize);
+
+    void insert(int id, float x, float y);
+    void move(int id, float x, float y);
+    void remove(int id);
+    bool contains(int id) const;
+
+    // Appends every entity within radius of (x, y) to results.
+    void query(float x, float y, float radius, std::vector<int>& results) const;
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        int64_t cell = 0;
+        uint32_t slot = 0; // Index inside the cell's member list
+        float x = 0.0f, y = 0.0f;
+        bool present = false;
+    };
+
+    int64_t cellKey(int cellX, int cellY) const;
+    int cellCoordinate(float value) const;
+    void detach(int id, const Entry& entry);
+    void attach(int id, Entry& entry);
+
+    float cellSize;
+    float inverseCellSize;
+    std::unordered_map<int64_t, std::vector<int>> cells;
+    std::vector<Entry> entries; // Indexed by id
+    size_t count = 0;
+};
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,53 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+
+#define TICK_SPIN_MARGIN_MIN 0.0002 // Seconds always left to spin before a deadline
+#define TICK_SPIN_MARGIN_MAX 0.004  // Cap on the spin window however badly sleeps overshoot
+#define TICK_MAX_CATCH_UP 4 // Ticks run back to back after a stall before the schedule is reset
+
+// Fixed-cadence tick pacing that neither drifts nor burns a core.
+//
+// waitForNextTick() sleeps until shortly before the next deadline, then
+// yields in a short spin for the remainder. The spin window follows how far
+// the OS has been overshooting sleeps lately, so it stays small on a quiet
+// host and grows when the scheduler is late to wake us.
+//
+// Deadlines advance by exactly one interval per tick. A late tick is made
+// up by returning immediately, up to TICK_MAX_CATCH_UP ticks behind; past
+// that the schedule restarts from now and the skipped ticks are counted.
+class TickScheduler {
+public:
+    struct Stats {
+        uint64_t ticks = 0;
+        double latenessTotal = 0.0; // Seconds between each deadline and the wakeup
+        double latenessMax = 0.0;
+        uint64_t ticksSkipped = 0;
+    };
+
+    explicit TickScheduler(double interval);
+    ~TickScheduler();
+
+    // Returns how far past its deadline the tick is starting
+    std::chrono::steady_clock::duration waitForNextTick();
+
+    // Takes effect from the next deadline, e.g. to drop to an idle rate
+    void setInterval(double interval);
+    double interval() const;
+    double spinMargin() const;
+
+    // Returns the counters gathered since the last call and resets them
+    Stats takeStats();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration tickInterval;
+    Clock::time_point nextDeadline;
+    double oversleepEstimate; // Recent sleep overshoot in seconds, smoothed
+    Stats stats;
+};
+
+#endif // TICK_SCHEDULER_H
@@ -0,0 +1,74 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define TIMER_WHEEL_LEVELS 4 // 64^4 ticks, about 72 hours at 64 Hz, before timers park at the top level
+#define TIMER_WHEEL_SLOT_BITS 6
+
+// Hierarchical timing wheel driven by the server tick.
+//
+// Level 0 has one slot per tick for the next 64 ticks; each level above
+// covers 64 times the span of the one below. A timer sits in the coarsest
+// slot that still separates it from now and cascades down as the wheel
+// turns, so scheduling and cancelling are O(1) and advancing costs
+// O(timers fired + timers cascaded) rather than O(timers pending).
+//
+// Timers carry a kind and two integers instead of a callback so callers
+// dispatch with a switch and the wheel never allocates per timer once its
+// node pool has grown.
+//
+// Not thread-safe: owned by the tick thread.
+class TimerWheel {
+public:
+    typedef uint64_t TimerId; // 0 is never a valid id
+
+    struct FiredTimer {
+        uint32_t kind;
+        int32_t target;
+        uint32_t data;
+    };
+
+    TimerWheel();
+
+    // Fires on the first advance() that reaches currentTick() + delayTicks (at least one tick away)
+    TimerId schedule(uint64_t delayTicks, uint32_t kind, int32_t target, uint32_t data);
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(TimerId id);
+
+    // Moves the wheel up to nowTick and appends every timer that came due to fired
+    size_t advance(uint64_t nowTick, std::vector<FiredTimer>& fired);
+
+    uint64_t currentTick() const;
+    size_t pending() const;
+
+private:
+    struct Node {
+        uint64_t deadline;
+        uint32_t kind;
+        int32_t target;
+        uint32_t data;
+        uint32_t generation;
+        int32_t prev;
+        int32_t next;
+        int32_t bucket; // -1 while on the free list
+    };
+
+    void place(int32_t index);
+    void link(int32_t index, int32_t bucket);
+    void unlink(int32_t index);
+    void release(int32_t index);
+    void cascade(int level);
+
+    static const int SLOTS = 1 << TIMER_WHEEL_SLOT_BITS;
+
+    std::vector<Node> nodes;
+    std::vector<int32_t> freeNodes;
+    int32_t buckets[TIMER_WHEEL_LEVELS * SLOTS];
+    uint64_t now;
+    size_t pendingCount;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Single-writer, single-reader triple buffer. The writer fills its private
+// slot and publishes it with one atomic exchange; the reader picks up the
+// most recently published slot with another. Neither side ever waits on the
+// other, and a slow reader simply skips to the newest value. Slots are reused,
+// so containers inside T keep their capacity between publishes.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side: the slot being filled. Not visible to the reader until publish().
+    T& writeBuffer() {
+        return slots[writeIndex];
+    }
+
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(writeIndex | FreshBit), std::memory_order_acq_rel);
+        writeIndex = previous & IndexMask;
+    }
+
+    // Reader side: swaps in the newest published slot if there is one.
+    bool consume() {
+        if ((middle.load(std::memory_order_relaxed) & FreshBit) == 0) {
+            return false;
+        }
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(readIndex), std::memory_order_acq_rel);
+        readIndex = previous & IndexMask;
+        return true;
+    }
+
+    const T& readBuffer() const {
+        return slots[readIndex];
+    }
+
+private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t FreshBit = 0x4;
+
+    T slots[3];
+    alignas(64) std::atomic<uint8_t> middle{ 1 };
+    alignas(64) uint8_t writeIndex = 0;
+    alignas(64) uint8_t readIndex = 2;
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -1,10 +1,20 @@
 #include <alchemy/networkManager.h>
 #include <alchemy/player.h>
+#include <alchemy/bitstream.h>
+#include <alchemy/logger.h>
 #include <unordered_map>
 #include <sstream>
 #include <unordered_set>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstddef>
+#include <cmath>
 
-NetworkManager::NetworkManager() : client_addr_len(sizeof(client_addr)) {
+NetworkManager::NetworkManager()
+    : client_addr_len(sizeof(client_addr)), latestSnapshotTick(0), interpolationDelay(INTERPOLATION_DELAY), renderTick(0.0), nextInputTick(0), sampleTick(0), inputTick(0), inputAck(0), lastButtons(0),
+    predictedX(0.0f), predictedY(0.0f), spawnX(0.0f), spawnY(0.0f), viewRadius(0.0f), viewRadiusPending(false), datagramsSinceSend(0), slot(0), generation(0) {
     std::srand(static_cast<unsigned int>(std::time(0)));
 }
 
@@ -48,91 +58,591 @@ void NetworkManager::setupUDPClient() {
     }
 }
 
-void NetworkManager::sendChatMessage(int clientId, const char* message) {
-    OutGoingPacket packet;
-    packet.type = ChatMessage;
-    packet.clientId = clientId;
-    strncpy_s(packet.chatData.message, message, sizeof(packet.chatData.message) - 1);
-    packet.chatData.message[sizeof(packet.chatData.message) - 1] = '\0';
+// Asks the server for a player slot, retrying until it answers or CONNECT_TIMEOUT passes
+bool NetworkManager::connectToServer() {
+    OutGoingPacket request;
+    std::memset(&request, 0, sizeof(request));
+    request.type = Connect;
+
+    auto start = std::chrono::steady_clock::now();
+    auto nextAttempt = start;
+    auto retryInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(CONNECT_RETRY_INTERVAL));
+    auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(CONNECT_TIMEOUT));
 
-    sendto(sock, (char*)&packet, sizeof(OutGoingPacket), 0, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+    IncomingPacket reply;
+    while (std::chrono::steady_clock::now() - start < timeout) {
+        if (std::chrono::steady_clock::now() >= nextAttempt) {
+            sendto(sock, (char*)&request, sizeof(OutGoingPacket), 0, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+            nextAttempt += retryInterval;
+        }
+
+        int bytesReceived = recvfrom(sock, (char*)&reply, sizeof(IncomingPacket), 0, (struct sockaddr*)&client_addr, &client_addr_len);
+        if (bytesReceived >= static_cast<int>(SNAPSHOT_HEADER_SIZE + sizeof(reply.connectData)) && reply.type == ConnectAccepted) {
+            slot = reply.connectData.slot;
+            generation = reply.connectData.generation;
+            predictedX = spawnX = reply.connectData.x;
+            predictedY = spawnY = reply.connectData.y;
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
 }
 
-void NetworkManager::sendPlayerMovement(int clientId, float x, float y) {
-    OutGoingPacket packet;
-    packet.type = PlayerMovement;
-    packet.clientId = clientId;
-    packet.movementData.x = x;
-    packet.movementData.y = y; 
+int NetworkManager::getPlayerId() const {
+    return slot;
+}
+
+glm::vec2 NetworkManager::getPredictedPosition() const {
+    return glm::vec2(predictedX, predictedY);
+}
+
+void NetworkManager::setInterpolationDelay(double seconds) {
+    interpolationDelay = std::max(seconds, 0.0);
+}
+
+double NetworkManager::getRoundTripTime() const {
+    return ackTracker.rtt();
+}
+
+double NetworkManager::getPacketLoss() const {
+    return ackTracker.loss();
+}
+
+// Numbers the packet and piggybacks our acks of the server's datagrams on it
+void NetworkManager::stampHeader(OutGoingPacket& packet) {
+    packet.header.sequence = ackTracker.send(std::chrono::steady_clock::now());
+    packet.header.ack = receiveWindow.ack();
+    packet.header.ackBits = receiveWindow.ackBits();
+    packet.header.ackDelay = encodeAckDelay(std::chrono::steady_clock::now() - newestReceivedAt);
+}
 
-    sendto(sock, (char*)&packet, sizeof(OutGoingPacket), 0, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+void NetworkManager::queueChatMessage(const char* message) {
+    pendingChat.emplace_back(message, std::min<size_t>(std::strlen(message), CHAT_MESSAGE_MAX));
 }
 
-void NetworkManager::sendHeatBeat(int clientId) {
+// One input per server tick, each sampled when it has to leave to reach
+// the server just before its tick. Sampling falls behind when frames are
+// slow; past INPUT_MAX_LATE_TICKS it skips ahead instead of sending a burst
+// the server could only apply late.
+bool NetworkManager::inputDue(double lookahead) {
+    auto now = std::chrono::steady_clock::now();
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(SERVER_TICK_INTERVAL));
+    if (!clock.synchronized()) {
+        // Nothing to stamp inputs with yet, but keep the tick cadence so acks and sync requests go out
+        sampleTick = 0;
+        if (now < nextUnsyncedInput) {
+            return false;
+        }
+        nextUnsyncedInput = std::max(nextUnsyncedInput + interval, now - interval);
+        return true;
+    }
+
+    uint32_t earliest = clock.targetTick(now);
+    if (nextInputTick == 0 || static_cast<int32_t>(earliest - nextInputTick) > INPUT_MAX_LATE_TICKS) {
+        nextInputTick = earliest;
+    }
+    auto horizon = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(std::clamp(lookahead, 0.0, INPUT_MAX_LOOKAHEAD)));
+    if (clock.sendTime(nextInputTick) > horizon) {
+        return false;
+    }
+    sampleTick = nextInputTick++;
+    return true;
+}
+
+void NetworkManager::queueInput(uint8_t buttons) {
+    uint32_t tick = sampleTick;
+    sampleTick = 0;
+    // The server keeps a player still between inputs, so after one idle input there is nothing to say
+    if (tick == 0 || (buttons == 0 && lastButtons == 0)) {
+        return;
+    }
+    lastButtons = buttons;
+
+    inputTick = tick;
+    applyPlayerInput(buttons, predictedX, predictedY);
+    inputHistory[inputTick % INPUT_HISTORY] = { inputTick, buttons, predictedX, predictedY };
+}
+
+void NetworkManager::queueViewRadius(float radius) {
+    viewRadius = radius;
+    viewRadiusPending = true;
+}
+
+// Sends at most one ClientUpdate per call, holding whatever was queued since
+// the last one. Nothing is sent unless there is a record to deliver, an ack
+// has waited CLIENT_ACK_INTERVAL (or half the ack window has filled), or the
+// keepalive is due. Time sync requests go out every CLOCK_SYNC_FAST_INTERVAL
+// until the first CLOCK_SYNC_SAMPLES have come back, then every
+// CLOCK_SYNC_INTERVAL to follow drift and changing latency.
+void NetworkManager::flushOutgoing() {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> sinceLastSend = now - lastSendAt;
+    std::chrono::duration<double> sinceLastSync = now - lastSyncAt;
+    bool keepAliveDue = sinceLastSend.count() >= CLIENT_KEEPALIVE_INTERVAL;
+    bool ackDue = datagramsSinceSend > 0 && (sinceLastSend.count() >= CLIENT_ACK_INTERVAL || datagramsSinceSend >= ACK_BITS / 2);
+    bool syncDue = sinceLastSync.count() >= (clock.samples() < CLOCK_SYNC_SAMPLES ? CLOCK_SYNC_FAST_INTERVAL : CLOCK_SYNC_INTERVAL);
+    bool hasRecords = inputTick > inputAck || viewRadiusPending || !pendingChat.empty() || syncDue;
+    if (!hasRecords && !ackDue && !keepAliveDue) {
+        return;
+    }
+
     OutGoingPacket packet;
-    packet.type = heartBeat;
-    packet.clientId = clientId;
+    packet.type = ClientUpdate;
+    packet.slot = slot;
+    packet.generation = generation;
+    packet.snapshotAck = latestSnapshotTick;
+    stampHeader(packet);
+
+    BitWriter writer(packet.records, sizeof(packet.records));
+    size_t countPosition = writer.bitPosition();
+    writer.writeBits(0, UPDATE_RECORD_COUNT_BITS);
+    uint32_t recordCount = 0;
+
+    // Inputs are repeated until a snapshot shows them applied, so a lost datagram costs none of them.
+    // A record holds consecutive ticks only; a run that ended in an idle input needs no repeating once another starts.
+    uint32_t inputCount = 0;
+    while (inputCount < INPUT_REDUNDANCY && inputTick - inputCount > inputAck &&
+        inputHistory[(inputTick - inputCount) % INPUT_HISTORY].tick == inputTick - inputCount) {
+        inputCount++;
+    }
+    if (inputCount > 0) {
+        writer.writeBits(InputRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(inputTick, 32);
+        writer.writeBits(inputCount, INPUT_COUNT_BITS);
+        for (uint32_t tick = inputTick - inputCount + 1; tick <= inputTick; ++tick) {
+            writer.writeBits(inputHistory[tick % INPUT_HISTORY].buttons, INPUT_BUTTON_BITS);
+        }
+        recordCount++;
+    }
+    if (viewRadiusPending) {
+        uint32_t radius;
+        std::memcpy(&radius, &viewRadius, sizeof(float));
+        writer.writeBits(ViewRadiusRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(radius, 32);
+        recordCount++;
+        viewRadiusPending = false;
+    }
+    if (syncDue) {
+        writer.writeBits(TimeSyncRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(ClockSync::requestTime(now), 32);
+        recordCount++;
+        lastSyncAt = now;
+    }
+
+    // Chat that does not fit waits for the next update
+    const uint32_t maxRecords = (1u << UPDATE_RECORD_COUNT_BITS) - 1;
+    while (!pendingChat.empty() && recordCount < maxRecords) {
+        const std::string& message = pendingChat.front();
+        size_t recordStart = writer.bitPosition();
+        writer.writeBits(ChatRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(static_cast<uint32_t>(message.size()), 8);
+        for (char c : message) {
+            writer.writeBits(static_cast<unsigned char>(c), 8);
+        }
+        if (writer.overflowed()) {
+            writer.rewind(recordStart);
+            break;
+        }
+        recordCount++;
+        pendingChat.pop_front();
+    }
+    writer.patchBits(countPosition, recordCount, UPDATE_RECORD_COUNT_BITS);
 
-    sendto(sock, (char*)&packet, sizeof(OutGoingPacket), 0, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+    int length = static_cast<int>(offsetof(OutGoingPacket, records) + writer.bytesWritten());
+    sendto(sock, (char*)&packet, length, 0, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+    lastSendAt = now;
+    datagramsSinceSend = 0;
 }
 
-bool NetworkManager::receiveData(std::unordered_map<int, Player>& players) {
+bool NetworkManager::receiveData() {
+    // Drain everything that arrived since the last frame, a snapshot may span several datagrams
     IncomingPacket incomingPacket;
-    int bytesReceived = recvfrom(sock, (char*)&incomingPacket, sizeof(IncomingPacket), 0, (struct sockaddr*)&client_addr, &client_addr_len);
-
-    if (bytesReceived > 0) {
-        if (incomingPacket.type == PlayerMovement && incomingPacket.movementUpdates.numPlayers > 0) {
-            // Set to track the player IDs received in this packet
-            std::unordered_set<int> receivedPlayerIds;
-
-            // Update player positions and collect the IDs from the incoming packet
-            for (int i = 0; i < incomingPacket.movementUpdates.numPlayers; ++i) {
-                const PlayerPosition& playerData = incomingPacket.movementUpdates.players[i];
-                int playerId = playerData.playerId;
-                float x = playerData.x;
-                float y = playerData.y;
-
-                receivedPlayerIds.insert(playerId);
-
-                auto it = players.find(playerId);
-                if (it != players.end()) {
-                    // Update the existing player's position
-                    it->second.updatePosition(x, y);
-                }
-                else {
-                    // If a new player is detected, add them to the map
-                    glm::vec3 defaultColor(1.0f, 1.0f, 1.0f); // White color
-                    Player newPlayer(playerId, defaultColor, x, y);
-                    players[playerId] = newPlayer;
-                }
-            }
+    bool updated = false;
+    while (true) {
+        int bytesReceived = recvfrom(sock, (char*)&incomingPacket, sizeof(IncomingPacket), 0, (struct sockaddr*)&client_addr, &client_addr_len);
+        if (bytesReceived == SOCKET_ERROR) {
+            int errorCode =
+#ifdef _WIN32
+                WSAGetLastError();
+#else
+                errno;
+#endif
+            LOG_DEBUG_RATE(1, "recvfrom failed with error code: {}", errorCode);
+            break;
+        }
+        if (bytesReceived <= 0) {
+            break;
+        }
 
-            // Remove players that are not present in the received list
-            for (auto it = players.begin(); it != players.end(); ) {
-                if (receivedPlayerIds.find(it->first) == receivedPlayerIds.end()) {
-                    // Player ID not in the received data, remove from map
-                    it = players.erase(it);
-                    // std::cout << "Player " << it->first << " removed due to inactivity." << std::endl;
-                }
-                else {
-                    ++it;
-                }
+        if (incomingPacket.type == ConnectAccepted) {
+            // A duplicate answer to one of our handshake retries
+            continue;
+        }
+        if (incomingPacket.type == TimeSync) {
+            // Like the handshake this is outside the sequence space; only its timestamps matter
+            if (bytesReceived >= static_cast<int>(SNAPSHOT_HEADER_SIZE + sizeof(incomingPacket.timeSyncData))) {
+                clock.addSample(incomingPacket.timeSyncData.requestedAt, incomingPacket.timeSyncData.receivedAt,
+                    incomingPacket.timeSyncData.sentAt, incomingPacket.tick, incomingPacket.timeSyncData.tickStart, std::chrono::steady_clock::now());
             }
+            continue;
+        }
 
-            return true;
+        // Late parts still count: parts of one snapshot may overtake each other, and the tick check below rejects stale snapshots
+        if (bytesReceived < static_cast<int>(sizeof(PacketHeader))) {
+            continue;
+        }
+        std::chrono::steady_clock::time_point receivedAt = std::chrono::steady_clock::now();
+        ReceiveWindow::Order order = receiveWindow.receive(incomingPacket.header.sequence);
+        if (order == ReceiveWindow::Duplicate) {
+            continue;
+        }
+        if (order == ReceiveWindow::Newest) {
+            newestReceivedAt = receivedAt;
+        }
+        ackTracker.acknowledge(incomingPacket.header.ack, incomingPacket.header.ackBits, incomingPacket.header.ackDelay, receivedAt);
+        datagramsSinceSend++;
+
+        if (incomingPacket.type != PlayerMovement && incomingPacket.type != PlayerMovementDelta) {
+            LOG_WARN_RATE(1, "Unexpected message type {} in the update.", incomingPacket.type);
+            continue;
+        }
+        if (!addSnapshotPart(incomingPacket, bytesReceived)) {
+            continue;
+        }
+
+        // Keep it as a baseline even if it arrived late, unless its history entry already holds something newer
+        ReceivedSnapshot& stored = snapshotHistory[decodedSnapshot.tick % SNAPSHOT_HISTORY];
+        if (stored.tick >= decodedSnapshot.tick) {
+            continue;
+        }
+        stored.tick = decodedSnapshot.tick;
+        stored.inputAck = decodedSnapshot.inputAck;
+        stored.players.swap(decodedSnapshot.players);
+
+        if (stored.tick > latestSnapshotTick) {
+            latestSnapshotTick = stored.tick;
+            updated = true;
+        }
+    }
+
+    // Only complete snapshots are applied, so players missing from one part never despawn
+    if (updated) {
+        applySnapshot(snapshotHistory[latestSnapshotTick % SNAPSHOT_HISTORY]);
+        reconcile(snapshotHistory[latestSnapshotTick % SNAPSHOT_HISTORY]);
+    }
+    return updated;
+}
+
+// Returns true once the packet completes its snapshot, which is then in decodedSnapshot
+bool NetworkManager::addSnapshotPart(const IncomingPacket& packet, int bytesReceived) {
+    if (bytesReceived < static_cast<int>(SNAPSHOT_HEADER_SIZE) || packet.partCount == 0 ||
+        packet.partCount > MAX_SNAPSHOT_PARTS || packet.partIndex >= packet.partCount) {
+        return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    SnapshotAssembly& assembly = assemblies[packet.tick % SNAPSHOT_ASSEMBLY_SLOTS];
+    if (assembly.tick != packet.tick) {
+        if (assembly.tick > packet.tick) {
+            return false;
+        }
+
+        // Start over; whatever was pending in this slot is older and abandoned
+        assembly.tick = packet.tick;
+        assembly.inputAck = packet.inputAck;
+        assembly.type = packet.type;
+        assembly.partCount = packet.partCount;
+        assembly.receivedParts = 0;
+        assembly.startedAt = now;
+        assembly.players.clear();
+        assembly.removed.clear();
+        assembly.changed.clear();
+    }
+
+    std::chrono::duration<double> waited = now - assembly.startedAt;
+    uint32_t partBit = 1u << packet.partIndex;
+    if (assembly.type != packet.type || assembly.partCount != packet.partCount ||
+        (assembly.receivedParts & partBit) != 0 || waited.count() > SNAPSHOT_REASSEMBLY_TIMEOUT) {
+        return false;
+    }
+
+    bool decoded = packet.type == PlayerMovement
+        ? decodeFullSnapshotPart(packet, bytesReceived, assembly)
+        : decodeDeltaSnapshotPart(packet, bytesReceived, assembly);
+    if (!decoded) {
+        return false;
+    }
+
+    assembly.receivedParts |= partBit;
+    if (assembly.receivedParts != (1u << assembly.partCount) - 1) {
+        return false;
+    }
+    return completeSnapshot(assembly, decodedSnapshot);
+}
+
+bool NetworkManager::decodeFullSnapshotPart(const IncomingPacket& packet, int bytesReceived, SnapshotAssembly& assembly) {
+    BitReader reader(packet.payload, bytesReceived - SNAPSHOT_HEADER_SIZE);
+    int fractionBits = static_cast<int>(reader.readBits(5));
+    int32_t originX = reader.readSignedVarint();
+    int32_t originY = reader.readSignedVarint();
+    int xBits = static_cast<int>(reader.readBits(6));
+    int yBits = static_cast<int>(reader.readBits(6));
+    uint32_t numPlayers = reader.readBits(16);
+    if (reader.overflowed() || xBits > 32 || yBits > 32) {
+        return false;
+    }
+
+    size_t firstNew = assembly.players.size();
+    int playerId = 0;
+    for (uint32_t i = 0; i < numPlayers && !reader.overflowed(); ++i) {
+        playerId += reader.readSignedVarint();
+        int32_t x = originX + static_cast<int32_t>(reader.readBits(xBits));
+        int32_t y = originY + static_cast<int32_t>(reader.readBits(yBits));
+        assembly.players.push_back({ playerId, dequantizePosition(x, fractionBits), dequantizePosition(y, fractionBits) });
+    }
+
+    // Never trust a count beyond what actually arrived
+    if (reader.overflowed()) {
+        assembly.players.resize(firstNew);
+        return false;
+    }
+    return true;
+}
+
+bool NetworkManager::decodeDeltaSnapshotPart(const IncomingPacket& packet, int bytesReceived, SnapshotAssembly& assembly) {
+    BitReader reader(packet.payload, bytesReceived - SNAPSHOT_HEADER_SIZE);
+    uint32_t baselineTick = reader.readBits(32);
+    int fractionBits = static_cast<int>(reader.readBits(5));
+    int32_t originX = reader.readSignedVarint();
+    int32_t originY = reader.readSignedVarint();
+    int xBits = static_cast<int>(reader.readBits(6));
+    int yBits = static_cast<int>(reader.readBits(6));
+    uint32_t numRemoved = reader.readBits(16);
+    uint32_t numChanged = reader.readBits(16);
+    uint32_t numAdded = reader.readBits(16);
+    if (reader.overflowed() || xBits > 32 || yBits > 32) {
+        return false;
+    }
+    if (assembly.receivedParts != 0 && (assembly.baselineTick != baselineTick || assembly.fractionBits != fractionBits)) {
+        return false;
+    }
+
+    size_t firstRemoved = assembly.removed.size();
+    size_t firstChanged = assembly.changed.size();
+    size_t firstAdded = assembly.players.size();
+
+    int playerId = 0;
+    for (uint32_t i = 0; i < numRemoved && !reader.overflowed(); ++i) {
+        playerId += reader.readSignedVarint();
+        assembly.removed.push_back(playerId);
+    }
+
+    playerId = 0;
+    for (uint32_t i = 0; i < numChanged && !reader.overflowed(); ++i) {
+        playerId += reader.readSignedVarint();
+        int32_t dx = reader.readSignedVarint();
+        int32_t dy = reader.readSignedVarint();
+        assembly.changed.push_back({ playerId, dx, dy });
+    }
+
+    playerId = 0;
+    for (uint32_t i = 0; i < numAdded && !reader.overflowed(); ++i) {
+        playerId += reader.readSignedVarint();
+        int32_t x = originX + static_cast<int32_t>(reader.readBits(xBits));
+        int32_t y = originY + static_cast<int32_t>(reader.readBits(yBits));
+        assembly.players.push_back({ playerId, dequantizePosition(x, fractionBits), dequantizePosition(y, fractionBits) });
+    }
+
+    if (reader.overflowed()) {
+        assembly.removed.resize(firstRemoved);
+        assembly.changed.resize(firstChanged);
+        assembly.players.resize(firstAdded);
+        return false;
+    }
+    assembly.baselineTick = baselineTick;
+    assembly.fractionBits = fractionBits;
+    return true;
+}
+
+bool NetworkManager::completeSnapshot(SnapshotAssembly& assembly, ReceivedSnapshot& snapshot) {
+    // Parts arrive in any order, but each one lists its entries by player id
+    auto byId = [](const PlayerPosition& lhs, const PlayerPosition& rhs) { return lhs.playerId < rhs.playerId; };
+    std::sort(assembly.players.begin(), assembly.players.end(), byId);
+    snapshot.tick = assembly.tick;
+    snapshot.inputAck = assembly.inputAck;
+
+    if (assembly.type == PlayerMovement) {
+        snapshot.players.assign(assembly.players.begin(), assembly.players.end());
+        return true;
+    }
+
+    const ReceivedSnapshot& baseline = snapshotHistory[assembly.baselineTick % SNAPSHOT_HISTORY];
+    if (baseline.tick != assembly.baselineTick || baseline.tick == 0) {
+        // We no longer have the baseline; our ack will stall and the server falls back to a full snapshot
+        return false;
+    }
+
+    std::vector<int>& removed = assembly.removed;
+    std::vector<PositionStep>& changed = assembly.changed;
+    std::sort(removed.begin(), removed.end());
+    std::sort(changed.begin(), changed.end(), [](const PositionStep& lhs, const PositionStep& rhs) { return lhs.playerId < rhs.playerId; });
+
+    // Baseline and every list are sorted by player id
+    int fractionBits = assembly.fractionBits;
+    snapshot.players.clear();
+    size_t changedIndex = 0;
+    size_t removedIndex = 0;
+    for (const PlayerPosition& player : baseline.players) {
+        while (removedIndex < removed.size() && removed[removedIndex] < player.playerId) {
+            ++removedIndex;
+        }
+        if (removedIndex < removed.size() && removed[removedIndex] == player.playerId) {
+            continue;
+        }
+        while (changedIndex < changed.size() && changed[changedIndex].playerId < player.playerId) {
+            ++changedIndex;
+        }
+        if (changedIndex < changed.size() && changed[changedIndex].playerId == player.playerId) {
+            int32_t x = quantizePosition(player.x, fractionBits) + changed[changedIndex].dx;
+            int32_t y = quantizePosition(player.y, fractionBits) + changed[changedIndex].dy;
+            snapshot.players.push_back({ player.playerId, dequantizePosition(x, fractionBits), dequantizePosition(y, fractionBits) });
         }
         else {
-            std::cerr << "Unexpected message type or no players in the update." << std::endl;
+            snapshot.players.push_back(player);
         }
     }
-    else if (bytesReceived == SOCKET_ERROR) {
-        int errorCode =
-#ifdef _WIN32
-            WSAGetLastError();
-#else
-            errno;
-#endif
-        // std::cerr << "recvfrom failed with error code: " << errorCode << std::endl;
+
+    size_t mergedCount = snapshot.players.size();
+    snapshot.players.insert(snapshot.players.end(), assembly.players.begin(), assembly.players.end());
+    std::inplace_merge(snapshot.players.begin(), snapshot.players.begin() + mergedCount, snapshot.players.end(), byId);
+    return true;
+}
+
+void NetworkManager::applySnapshot(const ReceivedSnapshot& snapshot) {
+    // Players entering or leaving view are queued for the tick of this snapshot rather than
+    // shown or hidden now, since everyone else is still drawn interpolationDelay in the past
+    std::unordered_set<int> receivedPlayerIds;
+    for (const PlayerPosition& playerData : snapshot.players) {
+        int playerId = playerData.playerId;
+
+        // We are drawn where our own inputs put us, not where the server last saw us
+        if (playerId == slot) {
+            continue;
+        }
+        receivedPlayerIds.insert(playerId);
+
+        if (visiblePlayers.insert(playerId).second) {
+            visibilityChanges.push_back({ snapshot.tick, playerId, true });
+        }
+        remotePlayers[playerId].push(snapshot.tick, playerData.x, playerData.y);
     }
-    return false;
+
+    for (auto it = visiblePlayers.begin(); it != visiblePlayers.end(); ) {
+        if (receivedPlayerIds.find(*it) == receivedPlayerIds.end()) {
+            visibilityChanges.push_back({ snapshot.tick, *it, false });
+            it = visiblePlayers.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+// Compares where the server has us after the inputs it applied with where
+// our prediction had us after the same inputs. Inputs the server has not
+// applied yet are unaffected by the difference, so a mismatch beyond
+// quantization shifts them and the current prediction by it.
+void NetworkManager::reconcile(const ReceivedSnapshot& snapshot) {
+    if (snapshot.inputAck < inputAck || snapshot.inputAck > inputTick) {
+        return;
+    }
+    inputAck = snapshot.inputAck;
+
+    auto own = std::lower_bound(snapshot.players.begin(), snapshot.players.end(), static_cast<int>(slot),
+        [](const PlayerPosition& player, int playerId) { return player.playerId < playerId; });
+    if (own == snapshot.players.end() || own->playerId != slot) {
+        return;
+    }
+
+    float expectedX = spawnX;
+    float expectedY = spawnY;
+    if (inputAck != 0) {
+        const PredictedInput& applied = inputHistory[inputAck % INPUT_HISTORY];
+        if (applied.tick != inputAck) {
+            return;
+        }
+        expectedX = applied.x;
+        expectedY = applied.y;
+    }
+
+    float dx = own->x - expectedX;
+    float dy = own->y - expectedY;
+    if (std::abs(dx) <= PREDICTION_TOLERANCE && std::abs(dy) <= PREDICTION_TOLERANCE) {
+        return;
+    }
+
+    LOG_DEBUG_RATE(1, "Corrected our predicted position by ({}, {}) after input {}", dx, dy, inputAck);
+    if (inputAck == 0) {
+        spawnX += dx;
+        spawnY += dy;
+    }
+    for (PredictedInput& input : inputHistory) {
+        if (input.tick >= inputAck && input.tick != 0) {
+            input.x += dx;
+            input.y += dy;
+        }
+    }
+    predictedX += dx;
+    predictedY += dy;
+}
+
+// The server's tick now, less the half round trip a snapshot takes to reach
+// us, is the newest snapshot we could have; remote players are drawn
+// interpolationDelay behind that. The delay has to span the gap between
+// snapshots plus their jitter, or players run out of positions and are
+// extrapolated.
+bool NetworkManager::interpolatePlayers(std::unordered_map<int, Player>& players) {
+    if (clock.synchronized()) {
+        double behind = (clock.rtt() / 2.0 + interpolationDelay) / SERVER_TICK_INTERVAL;
+        renderTick = std::max(renderTick, clock.serverTick(std::chrono::steady_clock::now()) - behind);
+    }
+    else {
+        // Nothing to place the server's ticks on our clock yet; show the newest positions as they arrive
+        renderTick = latestSnapshotTick;
+    }
+
+    // Queued in snapshot order, so the ones the render time has reached are at the front
+    bool spawned = false;
+    while (!visibilityChanges.empty() && visibilityChanges.front().tick <= renderTick) {
+        const VisibilityChange& change = visibilityChanges.front();
+        if (change.visible) {
+            // Positions from before it last left view are still drawn until then, so they go only now
+            remotePlayers[change.playerId].dropBefore(change.tick);
+            glm::vec3 defaultColor(1.0f, 1.0f, 1.0f); // White color
+            players[change.playerId] = Player(change.playerId, defaultColor, 0.0f, 0.0f);
+            spawned = true;
+        }
+        else {
+            players.erase(change.playerId);
+            // Unless it has come back into view since, in which case its newer positions are still needed
+            if (visiblePlayers.find(change.playerId) == visiblePlayers.end()) {
+                remotePlayers.erase(change.playerId);
+            }
+        }
+        visibilityChanges.pop_front();
+    }
+
+    for (auto& pair : players) {
+        auto buffer = remotePlayers.find(pair.first);
+        if (buffer == remotePlayers.end() || buffer->second.empty()) {
+            continue;
+        }
+
+        glm::vec2 position = pair.second.getPosition();
+        buffer->second.sample(renderTick, EXTRAPOLATION_LIMIT / SERVER_TICK_INTERVAL, position.x, position.y);
+        pair.second.updatePosition(position.x, position.y);
+    }
+    return spawned;
 }
@@ -0,0 +1,260 @@
+#include <alchemy/broadcastEngine.h>
+#include <alchemy/logger.h>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <system_error>
+
+#ifdef __linux__
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#define SENDMMSG_MAX_BATCH 1024 // UIO_MAXIOV, the kernel cap on messages per sendmmsg
+#define GSO_MAX_SEGMENTS 64     // UDP_MAX_SEGMENTS in the kernel
+#endif
+
+BroadcastEngine::BroadcastEngine(SOCKET socket, bool useGso, bool useIoUring)
+    : socket(socket), useGso(false) {
+#ifdef HAS_IO_URING
+    // The ring itself waits for the first flush, on the thread that will submit to it
+    this->useIoUring = useIoUring && socket != INVALID_SOCKET;
+#else
+    (void)useIoUring;
+#endif
+#ifdef __linux__
+    if (useGso && socket != INVALID_SOCKET) {
+        // Probe for UDP_SEGMENT support; kernels older than 4.18 reject the option
+        int segmentSize = 0;
+        socklen_t optionLength = sizeof(segmentSize);
+        this->useGso = getsockopt(socket, SOL_UDP, UDP_SEGMENT, &segmentSize, &optionLength) == 0;
+        if (!this->useGso) {
+            std::cerr << "UDP_SEGMENT not supported by this kernel, sending without GSO." << std::endl;
+        }
+    }
+#else
+    (void)useGso;
+#endif
+}
+
+void BroadcastEngine::queue(const sockaddr_in& destination, const void* data, int length) {
+    size_t offset = payload.size();
+    payload.resize(offset + length);
+    std::memcpy(payload.data() + offset, data, length);
+    pending.push_back({ destination, offset, length });
+}
+
+void BroadcastEngine::flush() {
+    stats = TickStats();
+
+    if (socket == INVALID_SOCKET) {
+        for (const PendingDatagram& datagram : pending) {
+            stats.datagrams++;
+            stats.bytes += datagram.length;
+        }
+    }
+    else {
+#ifdef __linux__
+        flushBatched();
+#else
+        flushSequential();
+#endif
+    }
+
+    // Keep the capacity so steady-state ticks do not allocate
+    payload.clear();
+    pending.clear();
+}
+
+bool BroadcastEngine::gsoEnabled() const {
+    return useGso;
+}
+
+bool BroadcastEngine::ioUringEnabled() const {
+#ifdef HAS_IO_URING
+    return useIoUring;
+#else
+    return false;
+#endif
+}
+
+const BroadcastEngine::TickStats& BroadcastEngine::lastTickStats() const {
+    return stats;
+}
+
+void BroadcastEngine::flushSequential() {
+    for (const PendingDatagram& datagram : pending) {
+        int sentBytes = sendto(socket, payload.data() + datagram.offset, datagram.length, 0,
+            (const struct sockaddr*)&datagram.destination, sizeof(datagram.destination));
+        stats.syscalls++;
+        if (sentBytes == SOCKET_ERROR) {
+            LOG_WARN_RATE(1, "sendto failed with error code: {}", lastSocketError());
+            continue;
+        }
+        stats.datagrams++;
+        stats.bytes += sentBytes;
+    }
+}
+
+#ifdef __linux__
+static bool sameDestination(const sockaddr_in& lhs, const sockaddr_in& rhs) {
+    return lhs.sin_port == rhs.sin_port && lhs.sin_addr.s_addr == rhs.sin_addr.s_addr;
+}
+
+void BroadcastEngine::flushBatched() {
+    const size_t controlSpace = CMSG_SPACE(sizeof(uint16_t));
+
+    headers.clear();
+    iovecs.clear();
+    datagramCounts.clear();
+    controls.assign(pending.size() * controlSpace, 0);
+
+    // Group runs of datagrams for the same client into one GSO message. All
+    // segments but the last must share the first segment's size.
+    size_t index = 0;
+    while (index < pending.size()) {
+        const PendingDatagram& first = pending[index];
+        size_t runEnd = index + 1;
+        if (useGso) {
+            while (runEnd < pending.size() && runEnd - index < GSO_MAX_SEGMENTS &&
+                sameDestination(pending[runEnd].destination, first.destination) &&
+                pending[runEnd - 1].length == first.length &&
+                pending[runEnd].length <= first.length &&
+                pending[runEnd].offset == pending[runEnd - 1].offset + pending[runEnd - 1].length) {
+                ++runEnd;
+            }
+        }
+
+        size_t runLength = 0;
+        for (size_t i = index; i < runEnd; ++i) {
+            runLength += pending[i].length;
+        }
+        iovecs.push_back({ payload.data() + first.offset, runLength });
+        datagramCounts.push_back(static_cast<int>(runEnd - index));
+
+        mmsghdr header{};
+        header.msg_hdr.msg_name = const_cast<sockaddr_in*>(&first.destination);
+        header.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        if (runEnd - index > 1) {
+            char* control = controls.data() + headers.size() * controlSpace;
+            header.msg_hdr.msg_control = control;
+            header.msg_hdr.msg_controllen = controlSpace;
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&header.msg_hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segmentSize = static_cast<uint16_t>(first.length);
+            std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+        }
+        headers.push_back(header);
+        index = runEnd;
+    }
+
+    // iovecs is complete, so its storage is stable and can be wired into the headers
+    for (size_t i = 0; i < headers.size(); ++i) {
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+#ifdef HAS_IO_URING
+    if (useIoUring && !ring) {
+        try {
+            ring = std::make_unique<IoUring>(IO_URING_QUEUE_DEPTH);
+        }
+        catch (const std::system_error& e) {
+            LOG_WARN("io_uring send ring setup failed: {}, falling back to sendmmsg", e.what());
+            useIoUring = false;
+        }
+    }
+    if (ring && sendWithIoUring()) {
+        return;
+    }
+#endif
+
+    size_t sent = 0;
+    while (sent < headers.size()) {
+        unsigned int batch = static_cast<unsigned int>(std::min<size_t>(headers.size() - sent, SENDMMSG_MAX_BATCH));
+        int result = sendmmsg(socket, headers.data() + sent, batch, 0);
+        stats.syscalls++;
+
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Send buffer is full; snapshots are superseded next tick, so drop the remainder
+                break;
+            }
+            // The first message in the batch failed; skip it and carry on with the rest
+            LOG_WARN_RATE(1, "sendmmsg failed with error code: {}", errno);
+            sent++;
+            continue;
+        }
+
+        for (int i = 0; i < result; ++i) {
+            stats.datagrams += datagramCounts[sent + i];
+            stats.bytes += headers[sent + i].msg_len;
+        }
+        sent += result;
+    }
+}
+#endif
+
+#ifdef HAS_IO_URING
+bool BroadcastEngine::sendWithIoUring() {
+    ringSent.assign(headers.size(), 0);
+    size_t queued = 0;
+    size_t completed = 0;
+    while (completed < headers.size()) {
+        while (queued < headers.size()) {
+            io_uring_sqe* sqe = ring->getSqe();
+            if (sqe == nullptr) {
+                break;
+            }
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = socket;
+            sqe->addr = reinterpret_cast<uint64_t>(&headers[queued].msg_hdr);
+            sqe->user_data = queued;
+            queued++;
+        }
+
+        // Headers must stay put until the kernel is done with them, so wait for everything queued
+        int result = ring->submit(static_cast<unsigned>(queued - completed));
+        stats.syscalls++;
+        if (result < 0 && result != -EINTR && result != -EBUSY) {
+            // Dropping the ring cancels whatever is still in flight before the headers are reused
+            LOG_WARN("io_uring send failed with error code: {}, falling back to sendmmsg", -result);
+            ring.reset();
+            useIoUring = false;
+
+            // Keep only the headers nothing was reaped for, in order, for sendmmsg to send
+            size_t kept = 0;
+            for (size_t i = 0; i < headers.size(); ++i) {
+                if (!ringSent[i]) {
+                    headers[kept] = headers[i];
+                    datagramCounts[kept] = datagramCounts[i];
+                    kept++;
+                }
+            }
+            headers.resize(kept);
+            datagramCounts.resize(kept);
+            return false;
+        }
+
+        io_uring_cqe* cqe;
+        while ((cqe = ring->peekCqe()) != nullptr) {
+            size_t index = static_cast<size_t>(cqe->user_data);
+            if (cqe->res >= 0) {
+                stats.datagrams += datagramCounts[index];
+                stats.bytes += cqe->res;
+            }
+            else if (cqe->res != -EAGAIN) {
+                LOG_WARN_RATE(1, "io_uring sendmsg failed with error code: {}", -cqe->res);
+            }
+            ringSent[index] = 1;
+            ring->seen();
+            completed++;
+        }
+    }
+    return true;
+}
+#endif
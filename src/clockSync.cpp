@@ -0,0 +1,80 @@
+#include <alchemy/clockSync.h>
+#include <algorithm>
+#include <cmath>
+
+ClockSync::ClockSync(double tickInterval)
+    : tickInterval(tickInterval) {
+    reset();
+}
+
+void ClockSync::reset() {
+    sampleCount = 0;
+    bestOffset = 0.0;
+    smoothedRtt = 0.0;
+    rttVariance = 0.0;
+    referenceTick = 0;
+    referenceTime = 0.0;
+}
+
+double ClockSync::seconds(Clock::time_point time) {
+    return std::chrono::duration<double>(time.time_since_epoch()).count();
+}
+
+uint32_t ClockSync::requestTime(Clock::time_point now) {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count());
+}
+
+void ClockSync::addSample(uint32_t requestedAt, int64_t serverReceived, int64_t serverSent, uint32_t tick, int64_t tickStart,
+    Clock::time_point received) {
+    // The echo only keeps the low 32 bits of our clock; a round trip is far shorter than their wrap
+    double roundTrip = static_cast<uint32_t>(requestTime(received) - requestedAt) * 1e-6;
+    double receivedAt = seconds(received);
+    double requested = receivedAt - roundTrip;
+    double serverHeld = std::max<double>(serverSent - serverReceived, 0.0) * 1e-6;
+
+    Sample sample;
+    sample.rtt = std::max(roundTrip - serverHeld, 0.0);
+    sample.offset = ((serverReceived * 1e-6 - requested) + (serverSent * 1e-6 - receivedAt)) / 2.0;
+    window[sampleCount % CLOCK_SYNC_SAMPLES] = sample;
+
+    if (sampleCount == 0) {
+        smoothedRtt = sample.rtt;
+        rttVariance = sample.rtt / 2.0;
+    }
+    else {
+        rttVariance += (std::abs(sample.rtt - smoothedRtt) - rttVariance) / 4.0;
+        smoothedRtt += (sample.rtt - smoothedRtt) / 8.0;
+    }
+    sampleCount++;
+
+    const Sample* fastest = &window[0];
+    for (int i = 1; i < std::min(sampleCount, CLOCK_SYNC_SAMPLES); ++i) {
+        if (window[i].rtt < fastest->rtt) {
+            fastest = &window[i];
+        }
+    }
+    bestOffset = fastest->offset;
+
+    referenceTick = tick;
+    referenceTime = tickStart * 1e-6;
+}
+
+double ClockSync::lead() const {
+    return smoothedRtt / 2.0 + rttVariance + INPUT_ARRIVAL_MARGIN;
+}
+
+uint32_t ClockSync::targetTick(Clock::time_point now) const {
+    double arrival = seconds(now) + bestOffset + lead();
+    int64_t ticks = static_cast<int64_t>(std::ceil((arrival - referenceTime) / tickInterval));
+    return static_cast<uint32_t>(static_cast<int64_t>(referenceTick) + ticks);
+}
+
+ClockSync::Clock::time_point ClockSync::sendTime(uint32_t tick) const {
+    double tickStart = referenceTime + static_cast<int32_t>(tick - referenceTick) * tickInterval;
+    double sendAt = tickStart - bestOffset - lead();
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(sendAt)));
+}
+
+double ClockSync::serverTick(Clock::time_point now) const {
+    return referenceTick + (seconds(now) + bestOffset - referenceTime) / tickInterval;
+}
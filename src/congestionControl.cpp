@@ -0,0 +1,54 @@
+#include <alchemy/congestionControl.h>
+#include <algorithm>
+
+void CongestionController::reset(Clock::time_point now) {
+    bytesPerSecond = SEND_BUDGET_INITIAL;
+    credit = 0.0;
+    bestRtt = 0.0;
+    ticksSinceSend = 0;
+    lostThisRound = 0;
+    limitedThisRound = false;
+    roundStart = now;
+}
+
+void CongestionController::onAcks(uint64_t newlyLost, double rtt, Clock::time_point now) {
+    if (rtt > 0.0 && (bestRtt == 0.0 || rtt < bestRtt)) {
+        bestRtt = rtt;
+    }
+    lostThisRound += newlyLost;
+
+    // One round trip is the shortest span in which a change of rate can show up in the acks
+    std::chrono::duration<double> sinceRoundStart = now - roundStart;
+    if (sinceRoundStart.count() < std::max(rtt, bestRtt)) {
+        return;
+    }
+
+    bool queueing = rtt > 0.0 && rtt > bestRtt + SEND_DELAY_THRESHOLD;
+    if (lostThisRound > 0 || queueing) {
+        bytesPerSecond = std::max(SEND_BUDGET_MIN, bytesPerSecond * SEND_BUDGET_DECREASE);
+    }
+    else if (limitedThisRound) {
+        bytesPerSecond = std::min(SEND_BUDGET_MAX, bytesPerSecond + SEND_BUDGET_INCREASE);
+    }
+    lostThisRound = 0;
+    limitedThisRound = false;
+    roundStart = now;
+}
+
+bool CongestionController::due(double elapsed) {
+    // Debt from forced sends is capped so a budget that recovers takes effect within SEND_MAX_INTERVAL ticks
+    double tickCredit = bytesPerSecond * elapsed;
+    credit = std::clamp(credit + tickCredit, -tickCredit * SEND_MAX_INTERVAL, tickCredit);
+    if (credit > 0.0 || ticksSinceSend + 1 >= SEND_MAX_INTERVAL) {
+        return true;
+    }
+
+    ticksSinceSend++;
+    limitedThisRound = true;
+    return false;
+}
+
+void CongestionController::onSent(int bytes) {
+    credit -= bytes;
+    ticksSinceSend = 0;
+}
@@ -0,0 +1,65 @@
+#include <alchemy/endpointTable.h>
+
+EndpointTable::EndpointTable(int capacity)
+    : capacity(static_cast<size_t>(capacity > 0 ? capacity : 1)), count(0) {
+    size_t size = 1;
+    while (size < this->capacity * 2) {
+        size <<= 1;
+    }
+    entries.assign(size, Entry{ 0, 0, -1 });
+    mask = size - 1;
+}
+
+size_t EndpointTable::home(uint32_t ip, uint16_t port) const {
+    return hashEndpoint(ip, port) & mask;
+}
+
+// Index of the endpoint's entry, or of the empty entry ending its probe run
+size_t EndpointTable::locate(uint32_t ip, uint16_t port) const {
+    size_t index = home(ip, port);
+    while (entries[index].value >= 0 && (entries[index].ip != ip || entries[index].port != port)) {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+int EndpointTable::find(const sockaddr_in& endpoint) const {
+    return entries[locate(endpoint.sin_addr.s_addr, endpoint.sin_port)].value;
+}
+
+bool EndpointTable::insert(const sockaddr_in& endpoint, int value) {
+    size_t index = locate(endpoint.sin_addr.s_addr, endpoint.sin_port);
+    if (entries[index].value < 0) {
+        if (count == capacity) {
+            return false;
+        }
+        count++;
+    }
+    entries[index] = { endpoint.sin_addr.s_addr, endpoint.sin_port, value };
+    return true;
+}
+
+bool EndpointTable::erase(const sockaddr_in& endpoint) {
+    size_t hole = locate(endpoint.sin_addr.s_addr, endpoint.sin_port);
+    if (entries[hole].value < 0) {
+        return false;
+    }
+
+    // Backward shift: pull later entries of the run into the hole unless that would put them before their home
+    size_t next = (hole + 1) & mask;
+    while (entries[next].value >= 0) {
+        size_t nextHome = home(entries[next].ip, entries[next].port);
+        if (((next - nextHome) & mask) >= ((next - hole) & mask)) {
+            entries[hole] = entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    entries[hole].value = -1;
+    count--;
+    return true;
+}
+
+size_t EndpointTable::size() const {
+    return count;
+}
@@ -1,7 +1,9 @@
 #include <alchemy/game.h>
+#include <alchemy/logger.h>
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
+#include <cmath>
 
 const char* Game::vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
@@ -30,10 +32,19 @@ const char* Game::redFragmentShaderSource = "#version 330 core\n"
 "   FragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);\n"
 "}\0";
 
-Game::Game(Mode mode)
-    : window(nullptr), VAO(0), VBO(0), shaderProgram(0), redShaderProgram(0), clientId(std::rand()), tickRate(1.0 / 64.0),
-    clientPlayer(clientId, glm::vec3(1.0f, 0.5f, 0.2f), 0.0f, 0.0f, 5.0f, 5.0f), projection(1.0f), cameraZoom(1.0f), currentMode(mode) {
+Game::Game(Mode mode, double interpolationDelay)
+    : window(nullptr), VAO(0), VBO(0), shaderProgram(0), redShaderProgram(0), clientId(0), tickRate(1.0 / 64.0),
+    clientPlayer(clientId, glm::vec3(1.0f, 0.5f, 0.2f), 0.0f, 0.0f, 5.0f, 5.0f), projection(1.0f), cameraZoom(1.0f),
+    viewRadius(0.0f), lastSentViewRadius(0.0f), ticksSinceViewRadiusSent(0), currentMode(mode) {
     networkManager.setupUDPClient();
+    networkManager.setInterpolationDelay(interpolationDelay);
+    if (!networkManager.connectToServer()) {
+        std::cerr << "Could not connect to the server." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    clientId = networkManager.getPlayerId();
+    glm::vec2 spawn = networkManager.getPredictedPosition();
+    clientPlayer = Player(clientId, glm::vec3(1.0f, 0.5f, 0.2f), spawn.x, spawn.y, 5.0f, 5.0f);
 
     initGLFW();
     initGLEW();
@@ -54,7 +65,6 @@ void Game::run() {
     setupBuffers();
 
     double previousTime = glfwGetTime();
-    double lag = 0.0;
     int frameCount = 0;
     double fpsTime = 0.0;
 
@@ -71,7 +81,6 @@ void Game::run() {
         double currentTime = glfwGetTime();
         double elapsed = currentTime - previousTime;
         previousTime = currentTime;
-        lag += elapsed;
 
         fpsTime += elapsed;
         frameCount++;
@@ -79,14 +88,14 @@ void Game::run() {
         // Calculate FPS every second
         if (fpsTime >= 1.0) {
             double fps = frameCount / fpsTime;
-            std::cout << "FPS: " << fps << " | Frame Time: " << (fpsTime / frameCount) * 1000.0 << " ms" << std::endl;
+            LOG_INFO("FPS: {} | Frame Time: {} ms", fps, (fpsTime / frameCount) * 1000.0);
             frameCount = 0;
             fpsTime = 0.0;
         }
 
-        while (lag >= tickRate) {
+        // Inputs follow the server's ticks rather than our frames; expect the next frame to take as long as this one
+        while (networkManager.inputDue(elapsed)) {
             processInput();
-            lag -= tickRate;
         }
 
         update(elapsed);
@@ -254,38 +263,53 @@ void Game::setupBuffers() {
 }
 
 void Game::processInput() {
-    bool positionUpdated = false;
-    float speed = 0.10f;
-    glm::vec2 position = clientPlayer.getPosition();
-
+    // The server moves us by these; we move ourselves the same way right away rather than wait for it
+    uint8_t buttons = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-        position.y += speed;
-        positionUpdated = true;
+        buttons |= InputUp;
     }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-        position.y -= speed;
-        positionUpdated = true;
+        buttons |= InputDown;
     }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-        position.x -= speed;
-        positionUpdated = true;
+        buttons |= InputLeft;
     }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-        position.x += speed;
-        positionUpdated = true;
+        buttons |= InputRight;
     }
-
-    if (positionUpdated) {
-        clientPlayer.updatePosition(position.x, position.y);
-        networkManager.sendPlayerMovement(clientId, position.x, position.y);
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+        buttons |= InputInteract;
     }
-    else {
-        networkManager.sendHeatBeat(clientId);
+    if (currentMode == Mode::Game && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+        buttons |= InputAttack;
     }
+
+    networkManager.queueInput(buttons);
+    glm::vec2 position = networkManager.getPredictedPosition();
+    clientPlayer.updatePosition(position.x, position.y);
+
+    // Tell the server how far we can see; resent once a second in case it was lost
+    ticksSinceViewRadiusSent++;
+    if (std::abs(viewRadius - lastSentViewRadius) > 0.5f || ticksSinceViewRadiusSent >= static_cast<int>(1.0 / tickRate)) {
+        networkManager.queueViewRadius(viewRadius);
+        lastSentViewRadius = viewRadius;
+        ticksSinceViewRadiusSent = 0;
+    }
+
+    // One datagram per tick at most, and none when there is nothing new to say
+    networkManager.flushOutgoing();
 }
 
 void Game::update(double deltaTime) {
-    if (networkManager.receiveData(players)) {
+    if (networkManager.receiveData()) {
+        // The snapshot may have corrected our prediction
+        glm::vec2 predicted = networkManager.getPredictedPosition();
+        clientPlayer.updatePosition(predicted.x, predicted.y);
+    }
+
+    // Every frame, not just when a snapshot arrives; that is what keeps remote players smooth.
+    // Players come into view here, once the render time reaches them, so load their textures now.
+    if (networkManager.interpolatePlayers(players)) {
         for (auto& pair : players) {
             int playerId = pair.first;
             Player& player = pair.second;
@@ -353,6 +377,9 @@ void Game::updateProjectionMatrix(int width, int height) {
     float viewWidth = 20.0f * cameraZoom;
     float viewHeight = viewWidth / aspectRatio;
 
+    // Half the view diagonal plus a margin so players walking into frame are already known
+    viewRadius = 0.5f * std::sqrt(viewWidth * viewWidth + viewHeight * viewHeight) + 2.0f;
+
     glm::vec2 playerPos = clientPlayer.getPosition();
 
     projection = glm::ortho(
@@ -0,0 +1,75 @@
+#include <alchemy/inputBuffer.h>
+
+InputBuffer::InputBuffer() {
+    reset();
+}
+
+void InputBuffer::reset() {
+    for (Entry& entry : entries) {
+        entry = Entry{};
+    }
+    applied = 0;
+    buffered = 0;
+    lateCount = 0;
+    skippedCount = 0;
+}
+
+bool InputBuffer::push(uint32_t tick, uint8_t buttons) {
+    if (tick <= applied) {
+        return false;
+    }
+
+    Entry& entry = entries[tick & (INPUT_BUFFER_SIZE - 1)];
+    if (entry.tick == tick) {
+        return false;
+    }
+    if (entry.tick > applied) {
+        // A whole buffer apart; the newer input wins and the older is never applied
+        if (entry.tick > tick) {
+            return false;
+        }
+        skippedCount++;
+    }
+    else {
+        buffered++;
+    }
+
+    entry.tick = tick;
+    entry.buttons = buttons;
+    return true;
+}
+
+int InputBuffer::consume(uint32_t tick, uint8_t* buttons) {
+    int count = 0;
+    while (buffered > 0 && count < INPUT_MAX_PER_TICK) {
+        const Entry* next = oldest();
+        if (next->tick > tick) {
+            break;
+        }
+        if (next->tick < tick) {
+            lateCount++;
+        }
+
+        buttons[count++] = next->buttons;
+        applied = next->tick;
+        buffered--;
+    }
+    return count;
+}
+
+// The pending input with the lowest stamp; buffered must be nonzero
+const InputBuffer::Entry* InputBuffer::oldest() const {
+    // While a player keeps moving the next stamp is the one after the last applied
+    const Entry* candidate = &entries[(applied + 1) & (INPUT_BUFFER_SIZE - 1)];
+    if (candidate->tick == applied + 1) {
+        return candidate;
+    }
+
+    candidate = nullptr;
+    for (const Entry& entry : entries) {
+        if (entry.tick > applied && (!candidate || entry.tick < candidate->tick)) {
+            candidate = &entry;
+        }
+    }
+    return candidate;
+}
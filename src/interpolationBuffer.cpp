@@ -0,0 +1,66 @@
+#include <alchemy/interpolationBuffer.h>
+#include <algorithm>
+
+InterpolationBuffer::InterpolationBuffer() {
+    reset();
+}
+
+void InterpolationBuffer::reset() {
+    for (Entry& entry : entries) {
+        entry = Entry{};
+    }
+    newest = 0;
+    count = 0;
+}
+
+void InterpolationBuffer::push(uint32_t tick, float x, float y) {
+    if (count > 0 && tick <= entries[newest].tick) {
+        return;
+    }
+
+    newest = (newest + 1) % INTERPOLATION_BUFFER_SIZE;
+    entries[newest] = { tick, x, y };
+    count = std::min(count + 1, INTERPOLATION_BUFFER_SIZE);
+}
+
+void InterpolationBuffer::dropBefore(uint32_t tick) {
+    while (count > 0 && entries[(newest + INTERPOLATION_BUFFER_SIZE - count + 1) % INTERPOLATION_BUFFER_SIZE].tick < tick) {
+        count--;
+    }
+}
+
+void InterpolationBuffer::sample(double renderTick, double maxExtrapolation, float& x, float& y) const {
+    if (count == 0) {
+        return;
+    }
+
+    const Entry& last = entries[newest];
+    if (renderTick >= last.tick) {
+        x = last.x;
+        y = last.y;
+        if (count > 1) {
+            const Entry& previous = entries[(newest + INTERPOLATION_BUFFER_SIZE - 1) % INTERPOLATION_BUFFER_SIZE];
+            double ahead = std::min(renderTick - last.tick, maxExtrapolation) / (last.tick - previous.tick);
+            x += static_cast<float>((last.x - previous.x) * ahead);
+            y += static_cast<float>((last.y - previous.y) * ahead);
+        }
+        return;
+    }
+
+    // Newest first, since the render time trails the newest position by only a few snapshots
+    const Entry* later = &last;
+    for (int i = 1; i < count; ++i) {
+        const Entry& earlier = entries[(newest + INTERPOLATION_BUFFER_SIZE - i) % INTERPOLATION_BUFFER_SIZE];
+        if (earlier.tick <= renderTick) {
+            double t = (renderTick - earlier.tick) / (later->tick - earlier.tick);
+            x = static_cast<float>(earlier.x + (later->x - earlier.x) * t);
+            y = static_cast<float>(earlier.y + (later->y - earlier.y) * t);
+            return;
+        }
+        later = &earlier;
+    }
+
+    // Further back than we kept; the oldest position is the best there is
+    x = later->x;
+    y = later->y;
+}
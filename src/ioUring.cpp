@@ -0,0 +1,200 @@
+#include <alchemy/ioUring.h>
+
+#ifdef HAS_IO_URING
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+IoUring::IoUring(unsigned entries) {
+    // Every ring has one submitting thread, which lets 6.1+ kernels defer completion work to our own io_uring_enter
+    io_uring_params params{};
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    ringFd = ioUringSetup(entries, &params);
+    if (ringFd < 0 && errno == EINVAL) {
+        params = io_uring_params{};
+        ringFd = ioUringSetup(entries, &params);
+    }
+    if (ringFd < 0) {
+        throw std::system_error(errno, std::system_category(), "io_uring_setup failed");
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = nullptr;
+        int error = errno;
+        close(ringFd);
+        throw std::system_error(error, std::system_category(), "io_uring submission ring mmap failed");
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing = sqRing;
+    }
+    else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = nullptr;
+            int error = errno;
+            munmap(sqRing, sqRingSize);
+            close(ringFd);
+            throw std::system_error(error, std::system_category(), "io_uring completion ring mmap failed");
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqeMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqeMemory == MAP_FAILED) {
+        int error = errno;
+        if (cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        munmap(sqRing, sqRingSize);
+        close(ringFd);
+        throw std::system_error(error, std::system_category(), "io_uring submission entries mmap failed");
+    }
+    sqes = static_cast<io_uring_sqe*>(sqeMemory);
+
+    unsigned char* sq = static_cast<unsigned char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    sqLocalTail = *sqTail;
+
+    unsigned char* cq = static_cast<unsigned char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+    // Closing the ring cancels anything still in flight before the buffers below go away
+    close(ringFd);
+    if (bufferRing != nullptr) {
+        munmap(bufferRing, bufferRingSize);
+    }
+    munmap(sqes, sqesSize);
+    if (cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    munmap(sqRing, sqRingSize);
+}
+
+bool IoUring::supported() {
+    try {
+        IoUring probe(8);
+        probe.registerBufferRing(0, 8, 64);
+        return true;
+    }
+    catch (const std::system_error&) {
+        return false;
+    }
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    unsigned head = std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+    if (sqLocalTail - head >= sqEntries) {
+        return nullptr;
+    }
+
+    unsigned index = sqLocalTail & sqMask;
+    sqArray[index] = index;
+    sqLocalTail++;
+    io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submit(unsigned waitFor) {
+    // Counted from the kernel's head so entries a short submit left behind go out next time
+    unsigned toSubmit = sqLocalTail - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+    std::atomic_ref<unsigned>(*sqTail).store(sqLocalTail, std::memory_order_release);
+
+    int result = ioUringEnter(ringFd, toSubmit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+    return result < 0 ? -errno : result;
+}
+
+io_uring_cqe* IoUring::peekCqe() {
+    unsigned head = *cqHead;
+    if (head == std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &cqes[head & cqMask];
+}
+
+void IoUring::seen() {
+    std::atomic_ref<unsigned>(*cqHead).store(*cqHead + 1, std::memory_order_release);
+}
+
+void IoUring::registerBufferRing(uint16_t groupId, unsigned count, unsigned size) {
+    // The ring must be page aligned, which mmap guarantees
+    bufferRingSize = count * sizeof(io_uring_buf);
+    void* ringMemory = mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ringMemory == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), "io_uring buffer ring mmap failed");
+    }
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(ringMemory);
+    registration.ring_entries = count;
+    registration.bgid = groupId;
+    if (ioUringRegister(ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        int error = errno;
+        munmap(ringMemory, bufferRingSize);
+        throw std::system_error(error, std::system_category(), "io_uring buffer ring registration failed");
+    }
+
+    bufferRing = static_cast<io_uring_buf*>(ringMemory);
+    bufferMask = count - 1;
+    bufferBytes = size;
+    bufferPool = std::make_unique<unsigned char[]>(static_cast<size_t>(count) * size);
+    for (unsigned id = 0; id < count; ++id) {
+        recycleBuffer(static_cast<uint16_t>(id));
+    }
+    commitBuffers();
+}
+
+unsigned char* IoUring::buffer(uint16_t id) {
+    return bufferPool.get() + static_cast<size_t>(id) * bufferBytes;
+}
+
+unsigned IoUring::bufferSize() const {
+    return bufferBytes;
+}
+
+void IoUring::recycleBuffer(uint16_t id) {
+    // Leaves resv alone, on the first entry that is the tail the kernel reads
+    io_uring_buf& entry = bufferRing[bufferTail & bufferMask];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+    entry.len = bufferBytes;
+    entry.bid = id;
+    bufferTail++;
+}
+
+void IoUring::commitBuffers() {
+    std::atomic_ref<uint16_t>(bufferRing[0].resv).store(bufferTail, std::memory_order_release);
+}
+#endif
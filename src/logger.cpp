@@ -0,0 +1,165 @@
+#include <alchemy/logger.h>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+bool LogRing::tryPush(const LogRecord& record) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) == LOG_RING_CAPACITY) {
+        return false;
+    }
+
+    records[currentTail & (LOG_RING_CAPACITY - 1)] = record;
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::tryPop(LogRecord& record) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    record = records[currentHead & (LOG_RING_CAPACITY - 1)];
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+}
+
+LogRateLimiter::LogRateLimiter(uint32_t perSecond)
+    : perSecond(perSecond) {}
+
+bool LogRateLimiter::allow(uint32_t& suppressed) {
+    int64_t second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // The first caller in a new second opens the window; a race here only lets a record or two extra through
+    int64_t window = windowStart.load(std::memory_order_relaxed);
+    if (window != second && windowStart.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        windowCount.store(0, std::memory_order_relaxed);
+    }
+
+    if (windowCount.fetch_add(1, std::memory_order_relaxed) < perSecond) {
+        suppressed = suppressedCount.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressedCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+// Copies a string argument into the record, cut short if the record's text is nearly full
+void Logger::appendText(LogRecord& record, LogArg& arg, const char* text, size_t length) {
+    arg.type = LogArg::String;
+    if (record.textUsed >= LOG_TEXT_CAPACITY) {
+        // Full; the last byte is always a terminator, so the argument prints as empty
+        arg.text = LOG_TEXT_CAPACITY - 1;
+        return;
+    }
+    arg.text = record.textUsed;
+    size_t room = LOG_TEXT_CAPACITY - record.textUsed - 1;
+    size_t copied = std::min(length, room);
+    std::memcpy(record.text + record.textUsed, text, copied);
+    record.text[record.textUsed + copied] = '\0';
+    record.textUsed += static_cast<uint32_t>(copied + 1);
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : start(std::chrono::steady_clock::now()) {
+    flusher = std::thread(&Logger::flushLoop, this);
+}
+
+Logger::~Logger() {
+    running.store(false, std::memory_order_relaxed);
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    drain();
+}
+
+LogRing& Logger::threadRing() {
+    thread_local LogRing* ring = nullptr;
+    if (ring == nullptr) {
+        // Rings outlive their threads so nothing logged just before a thread exits is lost
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(std::make_unique<LogRing>());
+        ring = rings.back().get();
+    }
+    return *ring;
+}
+
+void Logger::flush() {
+    drain();
+}
+
+void Logger::flushLoop() {
+    while (running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+        drain();
+    }
+}
+
+void Logger::drain() {
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        for (const std::unique_ptr<LogRing>& ring : rings) {
+            LogRecord record;
+            while (ring->tryPop(record)) {
+                batch.push_back(record);
+            }
+        }
+    }
+    if (batch.empty() && droppedRecords.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    std::stable_sort(batch.begin(), batch.end(),
+        [](const LogRecord& lhs, const LogRecord& rhs) { return lhs.timestamp < rhs.timestamp; });
+
+    static const char* levelNames[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+    std::ostringstream line;
+    for (const LogRecord& record : batch) {
+        line.str("");
+        line << '[' << std::fixed << std::setprecision(3) << record.timestamp / 1e9 << "] "
+            << levelNames[std::min<int>(record.level, LOG_LEVEL_ERROR)] << ' ';
+        line.unsetf(std::ios_base::floatfield);
+        line << std::setprecision(6);
+
+        int argIndex = 0;
+        for (const char* cursor = record.format; *cursor != '\0'; ++cursor) {
+            if (cursor[0] == '{' && cursor[1] == '}' && argIndex < record.argCount) {
+                const LogArg& arg = record.args[argIndex++];
+                switch (arg.type) {
+                case LogArg::Int: line << arg.i; break;
+                case LogArg::Uint: line << arg.u; break;
+                case LogArg::Double: line << arg.d; break;
+                case LogArg::String: line << record.text + arg.text; break;
+                }
+                ++cursor;
+            }
+            else {
+                line << *cursor;
+            }
+        }
+        if (record.suppressed > 0) {
+            line << " (" << record.suppressed << " similar suppressed)";
+        }
+        line << '\n';
+
+        (record.level >= LOG_LEVEL_WARN ? std::cerr : std::cout) << line.str();
+    }
+
+    uint64_t dropped = droppedRecords.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        std::cerr << "Logger dropped " << dropped << " records on full buffers\n";
+    }
+    std::cout.flush();
+    std::cerr.flush();
+}
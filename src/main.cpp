@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <cstdlib>
 #include <alchemy/game.h>
 #include <alchemy/server.h>
 
@@ -13,7 +14,78 @@ void displayMenu() {
     std::cout << "Enter your choice: ";
 }
 
-int main() {
+// Headless launch for dedicated servers and benchmarks:
+// game --server [--shards N] [--backend classic|io_uring] [--metrics-port PORT] [--metrics-file PATH] [--metrics-interval SECONDS]
+//               [--capture PATH] [--replay PATH [--replay-realtime]] [--client-rate HZ] [--client-burst PACKETS]
+//               [--fixed-send-rate] [--snapshot-rate HZ] [--spawn-area SIZE]
+// A replay takes the client rate and burst, send rate, snapshot rate and spawn area from the capture.
+bool parseServerArguments(int argc, char** argv, ServerConfig& config) {
+    bool startServer = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--server") {
+            startServer = true;
+        }
+        else if (argument == "--shards" && i + 1 < argc) {
+            config.receiveShards = std::atoi(argv[++i]);
+        }
+        else if (argument == "--backend" && i + 1 < argc) {
+            std::string backend = argv[++i];
+            config.backend = backend == "io_uring" ? IoUringBackend : ClassicBackend;
+        }
+        else if (argument == "--metrics-port" && i + 1 < argc) {
+            config.metricsPort = std::atoi(argv[++i]);
+        }
+        else if (argument == "--metrics-file" && i + 1 < argc) {
+            config.metricsFile = argv[++i];
+        }
+        else if (argument == "--metrics-interval" && i + 1 < argc) {
+            config.metricsFileInterval = std::atof(argv[++i]);
+        }
+        else if (argument == "--capture" && i + 1 < argc) {
+            config.capturePath = argv[++i];
+        }
+        else if (argument == "--replay" && i + 1 < argc) {
+            config.replayPath = argv[++i];
+        }
+        else if (argument == "--replay-realtime") {
+            config.replayRealTime = true;
+        }
+        else if (argument == "--client-rate" && i + 1 < argc) {
+            config.clientPacketRate = std::atof(argv[++i]);
+        }
+        else if (argument == "--client-burst" && i + 1 < argc) {
+            config.clientPacketBurst = std::atof(argv[++i]);
+        }
+        else if (argument == "--fixed-send-rate") {
+            config.adaptiveSendRate = false;
+        }
+        else if (argument == "--snapshot-rate" && i + 1 < argc) {
+            config.snapshotRate = std::atof(argv[++i]);
+        }
+        else if (argument == "--spawn-area" && i + 1 < argc) {
+            config.spawnArea = static_cast<float>(std::atof(argv[++i]));
+        }
+    }
+    return startServer;
+}
+
+int main(int argc, char** argv) {
+    ServerConfig serverConfig;
+    if (parseServerArguments(argc, argv, serverConfig)) {
+        Server server(serverConfig);
+        server.run();
+        return 0;
+    }
+
+    // game [--interp-delay SECONDS]: raise it when the server sends fewer snapshots (--snapshot-rate)
+    double interpolationDelay = INTERPOLATION_DELAY;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--interp-delay") {
+            interpolationDelay = std::atof(argv[++i]);
+        }
+    }
+
     while (true) {
         displayMenu();
 
@@ -22,19 +94,19 @@ int main() {
 
         if (choice == "1") {
             std::cout << "Starting Game...\n";
-            Game game(Mode::Game);
+            Game game(Mode::Game, interpolationDelay);
             game.run();
             break;
         }
         else if (choice == "2") {
             std::cout << "Starting Server...\n";
-            Server server;
+            Server server(serverConfig);
             server.run();
             break;
         }
         else if (choice == "3") {
             std::cout << "Starting Level Editor...\n";
-            Game game(Mode::LevelEdit);
+            Game game(Mode::LevelEdit, interpolationDelay);
             game.run();
             break;
         }
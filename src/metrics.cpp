@@ -0,0 +1,254 @@
+#include <alchemy/metrics.h>
+#include <alchemy/logger.h>
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#define METRICS_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define METRICS_SEND_FLAGS 0
+#endif
+
+#define METRICS_POLL_INTERVAL_MS 100 // How often the exporter checks for shutdown and file writes
+
+static const double exportedQuantiles[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+void Histogram::record(uint64_t value) {
+    counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t previousMax = max.load(std::memory_order_relaxed);
+    while (value > previousMax && !max.compare_exchange_weak(previousMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::snapshot(Snapshot& out) const {
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        out.counts[i] = counts[i].load(std::memory_order_relaxed);
+    }
+    out.count = count.load(std::memory_order_relaxed);
+    out.sum = sum.load(std::memory_order_relaxed);
+    out.max = max.load(std::memory_order_relaxed);
+}
+
+size_t Histogram::bucketIndex(uint64_t value) {
+    const uint64_t linearBuckets = uint64_t(1) << HISTOGRAM_SUB_BUCKET_BITS;
+    const uint64_t halfBuckets = linearBuckets >> 1;
+
+    value = std::min(value, (uint64_t(1) << HISTOGRAM_VALUE_BITS) - 1);
+    if (value < linearBuckets) {
+        return static_cast<size_t>(value);
+    }
+
+    // Keep the top HISTOGRAM_SUB_BUCKET_BITS bits; the shift says which power of two we are in
+    int shift = std::bit_width(value) - HISTOGRAM_SUB_BUCKET_BITS;
+    uint64_t mantissa = value >> shift;
+    return static_cast<size_t>((shift + 1) * halfBuckets + (mantissa - halfBuckets));
+}
+
+uint64_t Histogram::bucketHighestValue(size_t index) {
+    const uint64_t linearBuckets = uint64_t(1) << HISTOGRAM_SUB_BUCKET_BITS;
+    const uint64_t halfBuckets = linearBuckets >> 1;
+
+    if (index < linearBuckets) {
+        return index;
+    }
+    int shift = static_cast<int>(index / halfBuckets) - 1;
+    uint64_t mantissa = index % halfBuckets + halfBuckets;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+uint64_t Histogram::Snapshot::valueAtQuantile(double q) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * total + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // The top bucket may be wider than anything actually recorded
+            return std::min(bucketHighestValue(i), max);
+        }
+    }
+    return max;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(Entry{ name, help, CounterMetric, 1.0, std::make_unique<Counter>(), nullptr, nullptr });
+    return *entries.back().counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(Entry{ name, help, GaugeMetric, 1.0, nullptr, std::make_unique<Gauge>(), nullptr });
+    return *entries.back().gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, double unitScale) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(Entry{ name, help, HistogramMetric, unitScale, nullptr, nullptr, std::make_unique<Histogram>() });
+    return *entries.back().histogram;
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::ostringstream out;
+    out.precision(9);
+    std::unique_ptr<Histogram::Snapshot> snapshot = std::make_unique<Histogram::Snapshot>();
+    for (const Entry& entry : entries) {
+        out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+        switch (entry.type) {
+        case CounterMetric:
+            out << "# TYPE " << entry.name << " counter\n";
+            out << entry.name << ' ' << entry.counter->load() << '\n';
+            break;
+        case GaugeMetric:
+            out << "# TYPE " << entry.name << " gauge\n";
+            out << entry.name << ' ' << entry.gauge->load() << '\n';
+            break;
+        case HistogramMetric:
+            entry.histogram->snapshot(*snapshot);
+            out << "# TYPE " << entry.name << " summary\n";
+            for (double q : exportedQuantiles) {
+                out << entry.name << "{quantile=\"" << q << "\"} " << snapshot->valueAtQuantile(q) * entry.unitScale << '\n';
+            }
+            out << entry.name << "_sum " << snapshot->sum * entry.unitScale << '\n';
+            out << entry.name << "_count " << snapshot->count << '\n';
+            break;
+        }
+    }
+    return out.str();
+}
+
+MetricsExporter::MetricsExporter(const MetricsRegistry& registry, int port, const std::string& filePath, double fileInterval)
+    : registry(registry), filePath(filePath), fileInterval(fileInterval) {
+    if (port > 0) {
+        openListener(port);
+    }
+    if (listener != INVALID_SOCKET || !filePath.empty()) {
+        exporter = std::thread(&MetricsExporter::exportLoop, this);
+    }
+}
+
+MetricsExporter::~MetricsExporter() {
+    running.store(false, std::memory_order_relaxed);
+    if (exporter.joinable()) {
+        exporter.join();
+    }
+    if (listener != INVALID_SOCKET) {
+        closesocket(listener);
+    }
+}
+
+void MetricsExporter::openListener(int port) {
+    listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET) {
+        LOG_WARN("Metrics socket creation failed with error code: {}", lastSocketError());
+        return;
+    }
+
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    // Loopback only; anything remote goes through a local scraper or the file
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(listener, 8) == SOCKET_ERROR) {
+        // Not fatal: several servers on one host may all ask for the default port
+        LOG_WARN("Metrics listener on port {} failed with error code: {}", port, lastSocketError());
+        closesocket(listener);
+        listener = INVALID_SOCKET;
+        return;
+    }
+    LOG_INFO("Serving metrics on 127.0.0.1:{}", port);
+}
+
+void MetricsExporter::exportLoop() {
+    auto lastFileWrite = std::chrono::steady_clock::now();
+
+    while (running.load(std::memory_order_relaxed)) {
+        if (listener != INVALID_SOCKET) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(listener, &readable);
+            timeval timeout{ 0, METRICS_POLL_INTERVAL_MS * 1000 };
+            if (select(static_cast<int>(listener) + 1, &readable, nullptr, nullptr, &timeout) > 0) {
+                serveScrape();
+            }
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(METRICS_POLL_INTERVAL_MS));
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!filePath.empty() && now - lastFileWrite >= std::chrono::duration<double>(fileInterval)) {
+            writeFile();
+            lastFileWrite = now;
+        }
+    }
+}
+
+void MetricsExporter::serveScrape() {
+    SOCKET client = accept(listener, nullptr, nullptr);
+    if (client == INVALID_SOCKET) {
+        return;
+    }
+
+    // Whatever the request says the answer is the same, but read it so closing does not reset the connection
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(client, &readable);
+    timeval timeout{ 0, METRICS_POLL_INTERVAL_MS * 1000 };
+    if (select(static_cast<int>(client) + 1, &readable, nullptr, nullptr, &timeout) > 0) {
+        char request[1024];
+        recv(client, request, sizeof(request), 0);
+    }
+
+    std::string body = registry.renderPrometheus();
+    std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+        std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int result = send(client, response.data() + sent, static_cast<int>(response.size() - sent), METRICS_SEND_FLAGS);
+        if (result <= 0) {
+            break;
+        }
+        sent += result;
+    }
+    closesocket(client);
+}
+
+void MetricsExporter::writeFile() {
+    // Write aside and rename so readers never see a half-written dump
+    std::string temporaryPath = filePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::trunc);
+        if (!file) {
+            LOG_WARN_RATE(1, "Could not open metrics file {}", filePath.c_str());
+            return;
+        }
+        file << registry.renderPrometheus();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, filePath, error);
+    if (error) {
+        LOG_WARN_RATE(1, "Could not replace metrics file {}", filePath.c_str());
+    }
+}
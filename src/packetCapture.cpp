@@ -0,0 +1,71 @@
+#include <alchemy/packetCapture.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+CaptureWriter::CaptureWriter(const std::string& path, const CaptureSettings& settings)
+    : file(path, std::ios::binary | std::ios::trunc), start(std::chrono::steady_clock::now()) {
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "Could not create capture file " + path);
+    }
+    file.write(CAPTURE_MAGIC, 8);
+    file.write(reinterpret_cast<const char*>(&settings), sizeof(settings));
+}
+
+void CaptureWriter::record(const sockaddr_in& address, const void* data, int length, std::chrono::steady_clock::time_point receivedAt, uint32_t tick) {
+    CaptureRecordHeader header;
+    header.timestamp = receivedAt > start
+        ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(receivedAt - start).count()) : 0;
+    header.tick = tick;
+    header.address = address.sin_addr.s_addr;
+    header.port = address.sin_port;
+    header.length = static_cast<uint16_t>(std::clamp(length, 0, CAPTURE_MAX_DATAGRAM));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(static_cast<const char*>(data), header.length);
+}
+
+void CaptureWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    file.flush();
+}
+
+CaptureReader::CaptureReader(const std::string& path)
+    : file(path, std::ios::binary) {
+    if (!file) {
+        throw std::system_error(errno, std::generic_category(), "Could not open capture file " + path);
+    }
+
+    char magic[8];
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Not a capture file: " + path);
+    }
+    if (!file.read(reinterpret_cast<char*>(&recordedSettings), sizeof(recordedSettings))) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Truncated capture file: " + path);
+    }
+}
+
+const CaptureSettings& CaptureReader::settings() const {
+    return recordedSettings;
+}
+
+bool CaptureReader::next(CapturedDatagram& datagram) {
+    CaptureRecordHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.length > CAPTURE_MAX_DATAGRAM) {
+        return false;
+    }
+    if (!file.read(reinterpret_cast<char*>(datagram.data), header.length)) {
+        return false;
+    }
+
+    datagram.timestamp = header.timestamp;
+    datagram.tick = header.tick;
+    std::memset(&datagram.address, 0, sizeof(datagram.address));
+    datagram.address.sin_family = AF_INET;
+    datagram.address.sin_addr.s_addr = header.address;
+    datagram.address.sin_port = header.port;
+    datagram.length = header.length;
+    return true;
+}
@@ -0,0 +1,83 @@
+#include <alchemy/playerTable.h>
+#include <algorithm>
+#include <functional>
+
+PlayerTable::PlayerTable(int capacity)
+    : capacity(capacity), liveCount(0) {}
+
+int PlayerTable::allocate(const sockaddr_in& clientAddr, std::chrono::steady_clock::time_point now) {
+    int slot;
+    if (!freeSlots.empty()) {
+        std::pop_heap(freeSlots.begin(), freeSlots.end(), std::greater<int>());
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else if (highWater() < capacity) {
+        slot = highWater();
+        live.push_back(0);
+        generation.push_back(0);
+        x.push_back(0.0f);
+        y.push_back(0.0f);
+        viewRadius.push_back(0.0f);
+        ackedTick.push_back(0);
+        lastKeepAlive.push_back(now);
+        address.push_back(clientAddr);
+        heartbeatTimer.push_back(0);
+        receiveWindow.emplace_back();
+        inputs.emplace_back();
+        peerAck.push_back(0);
+        peerAckBits.push_back(0);
+        peerAckDelay.push_back(0);
+        peerAckAt.push_back(now);
+        connectedAt.push_back(now);
+        packetsReceived.push_back(0);
+        packetsRejected.push_back(0);
+    }
+    else {
+        return -1;
+    }
+
+    live[slot] = 1;
+    x[slot] = 0.0f;
+    y[slot] = 0.0f;
+    viewRadius[slot] = 0.0f;
+    ackedTick[slot] = 0;
+    lastKeepAlive[slot] = now;
+    address[slot] = clientAddr;
+    heartbeatTimer[slot] = 0;
+    receiveWindow[slot].reset();
+    inputs[slot].reset();
+    peerAck[slot] = 0;
+    peerAckBits[slot] = 0;
+    peerAckDelay[slot] = 0;
+    peerAckAt[slot] = now;
+    connectedAt[slot] = now;
+    packetsReceived[slot] = 0;
+    packetsRejected[slot] = 0;
+    liveCount++;
+    return slot;
+}
+
+void PlayerTable::release(int slot) {
+    if (slot < 0 || slot >= highWater() || !live[slot]) {
+        return;
+    }
+
+    live[slot] = 0;
+    generation[slot]++;
+    liveCount--;
+    freeSlots.push_back(slot);
+    std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<int>());
+}
+
+bool PlayerTable::isLive(int slot, uint16_t expectedGeneration) const {
+    return slot >= 0 && slot < highWater() && live[slot] && generation[slot] == expectedGeneration;
+}
+
+int PlayerTable::highWater() const {
+    return static_cast<int>(live.size());
+}
+
+size_t PlayerTable::size() const {
+    return liveCount;
+}
@@ -0,0 +1,82 @@
+#include <alchemy/rateLimiter.h>
+#include <algorithm>
+
+RateLimiter::RateLimiter(double rate, double burst, int capacity)
+    : mask(0), rate(rate), burst(static_cast<float>(std::max(burst, 1.0))), idleNanos(0), evicted(0) {
+    if (rate <= 0.0) {
+        return;
+    }
+
+    size_t size = 1;
+    while (size < static_cast<size_t>(std::max(capacity, RATE_LIMITER_PROBES))) {
+        size <<= 1;
+    }
+    buckets.resize(size);
+    mask = size - 1;
+    idleNanos = static_cast<int64_t>(this->burst / rate * 1e9);
+}
+
+size_t RateLimiter::home(uint32_t ip, uint16_t port) const {
+    return hashEndpoint(ip, port) & mask;
+}
+
+bool RateLimiter::allow(const sockaddr_in& address, std::chrono::steady_clock::time_point now) {
+    if (buckets.empty()) {
+        return true;
+    }
+
+    uint32_t ip = address.sin_addr.s_addr;
+    uint16_t port = address.sin_port;
+    int64_t nowNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+
+    Bucket* found = nullptr;
+    Bucket* reusable = nullptr;
+    Bucket* oldest = nullptr;
+    size_t index = home(ip, port);
+    for (int probe = 0; probe < RATE_LIMITER_PROBES; ++probe, index = (index + 1) & mask) {
+        Bucket& bucket = buckets[index];
+        if (bucket.used && bucket.ip == ip && bucket.port == port) {
+            found = &bucket;
+            break;
+        }
+        if (!reusable && (!bucket.used || nowNanos - bucket.lastSeen >= idleNanos)) {
+            reusable = &bucket;
+        }
+        if (!oldest || bucket.lastSeen < oldest->lastSeen) {
+            oldest = &bucket;
+        }
+    }
+
+    if (!found) {
+        if (!reusable) {
+            reusable = oldest;
+            evicted++;
+        }
+        found = reusable;
+        found->ip = ip;
+        found->port = port;
+        found->used = true;
+        found->tokens = burst;
+        found->lastSeen = nowNanos;
+    }
+
+    // Receive timestamps can step backwards a little across batches, never refill on those
+    if (nowNanos > found->lastSeen) {
+        found->tokens = std::min(burst, found->tokens + static_cast<float>((nowNanos - found->lastSeen) * 1e-9 * rate));
+        found->lastSeen = nowNanos;
+    }
+
+    if (found->tokens < 1.0f) {
+        return false;
+    }
+    found->tokens -= 1.0f;
+    return true;
+}
+
+bool RateLimiter::enabled() const {
+    return !buckets.empty();
+}
+
+uint64_t RateLimiter::evictions() const {
+    return evicted;
+}
@@ -2,12 +2,104 @@
 #include <chrono>
 #include <iostream>
 #include <stdexcept>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+Server::ServerMetrics::ServerMetrics(MetricsRegistry& registry)
+    : tickDuration(registry.histogram("alchemy_tick_duration_seconds", "Time spent inside one server tick.", 1e-9)),
+    tickLateness(registry.histogram("alchemy_tick_lateness_seconds", "How late each tick started against its deadline.", 1e-9)),
+    sendDuration(registry.histogram("alchemy_send_duration_seconds", "Time the send thread spends encoding and sending one snapshot.", 1e-9)),
+    commandLatency(registry.histogram("alchemy_command_latency_seconds", "Time from receiving a datagram to the tick applying it.", 1e-9)),
+    packetsReceived(registry.counter("alchemy_packets_received_total", "Datagrams received across all shards.")),
+    bytesReceived(registry.counter("alchemy_bytes_received_total", "Datagram payload bytes received across all shards.")),
+    packetsSent(registry.counter("alchemy_packets_sent_total", "Datagrams handed to the kernel, counted before GSO merging.")),
+    bytesSent(registry.counter("alchemy_bytes_sent_total", "Datagram payload bytes handed to the kernel.")),
+    commandsDropped(registry.counter("alchemy_commands_dropped_total", "Commands shed on a full inbound queue.")),
+    packetsRateLimited(registry.counter("alchemy_packets_rate_limited_total", "Datagrams dropped because their source address ran out of tokens.")),
+    packetsMalformed(registry.counter("alchemy_packets_malformed_total", "Datagrams too short for their type or of an unknown type.")),
+    snapshotsSkipped(registry.counter("alchemy_snapshots_skipped_total", "Published snapshots the send thread never got to.")),
+    snapshotsDeferred(registry.counter("alchemy_snapshots_deferred_total", "Per-client snapshots held back by congestion control.")),
+    snapshotEntriesDropped(registry.counter("alchemy_snapshot_entries_dropped_total", "Players left out of a full snapshot that outgrew MAX_SNAPSHOT_PARTS.")),
+    packetsRejected(registry.counter("alchemy_packets_rejected_total", "Client packets dropped as stale or duplicate by sequence, or view radii that were not finite.")),
+    packetsAcked(registry.counter("alchemy_packets_acked_total", "Sequenced datagrams the clients acknowledged.")),
+    packetsLost(registry.counter("alchemy_packets_lost_total", "Sequenced datagrams that left the ack window unacknowledged.")),
+    inputsApplied(registry.counter("alchemy_inputs_applied_total", "Client inputs run through the movement simulation.")),
+    inputsLate(registry.counter("alchemy_inputs_late_total", "Inputs applied after the tick they were stamped for.")),
+    clientRtt(registry.histogram("alchemy_client_rtt_seconds", "Round trip time from a datagram to the client's ack of it.", 1e-9)),
+    connectedClients(registry.gauge("alchemy_connected_clients", "Players holding a slot.")),
+    clientsSendLimited(registry.gauge("alchemy_clients_send_limited", "Clients held back by congestion control on the latest snapshot.")),
+    inboundQueueDepth(registry.gauge("alchemy_inbound_queue_depth", "Commands waiting when the last tick started draining.")),
+    timersPending(registry.gauge("alchemy_timers_pending", "Timers scheduled on the timer wheel.")) {}
+
+Server::Server(const ServerConfig& config)
+    : config(config), lastStatsReport(std::chrono::steady_clock::now()) {
+#ifdef __linux__
+    if (this->config.receiveShards < 1) {
+        this->config.receiveShards = 1;
+    }
+#else
+    if (this->config.receiveShards != 1) {
+        std::cerr << "Sharded receive needs SO_REUSEPORT; using a single receiver thread." << std::endl;
+        this->config.receiveShards = 1;
+    }
+#endif
+#ifdef HAS_IO_URING
+    if (this->config.backend == IoUringBackend && !IoUring::supported()) {
+        LOG_WARN("io_uring with provided buffers is unavailable on this kernel; using the classic backend.");
+        this->config.backend = ClassicBackend;
+    }
+#else
+    if (this->config.backend == IoUringBackend) {
+        LOG_WARN("This build has no io_uring support; using the classic backend.");
+        this->config.backend = ClassicBackend;
+    }
+#endif
+    if (!this->config.replayPath.empty()) {
+        // Opened here so the settings it was recorded with are in place before anything below uses them
+        replayReader = std::make_unique<CaptureReader>(this->config.replayPath);
+        applyCaptureSettings(replayReader->settings());
+    }
+    shardStats = std::make_unique<ReceiveShardStats[]>(this->config.receiveShards);
+    for (int shard = 0; shard < this->config.receiveShards; ++shard) {
+        rateLimiters.emplace_back(this->config.clientPacketRate, this->config.clientPacketBurst, RATE_LIMITER_CAPACITY);
+    }
+    if (this->config.snapshotRate > 0.0) {
+        snapshotStride = std::max<uint64_t>(1, static_cast<uint64_t>(std::lround(1.0 / (tickRate * this->config.snapshotRate))));
+    }
+    if (snapshotStride > 1) {
+        LOG_INFO("Sending snapshots every {} ticks, {} per second", snapshotStride, 1.0 / (tickRate * snapshotStride));
+    }
 
-Server::Server() {
     try {
         initializeWinSock();
-        createSocket();
-        bindSocket();
+        if (!this->config.replayPath.empty()) {
+            // Replay drives the tick directly; snapshots are encoded and counted but never sent
+            serverSocket = INVALID_SOCKET;
+            broadcaster = std::make_unique<BroadcastEngine>(INVALID_SOCKET, false);
+            return;
+        }
+
+        for (int shard = 0; shard < this->config.receiveShards; ++shard) {
+            SOCKET socket = createSocket();
+            receiveSockets.push_back(socket);
+            bindSocket(socket);
+        }
+        serverSocket = receiveSockets[0];
+        LOG_INFO("UDP server is listening on port {} with {} receive shard(s) on the {} backend...", SERVER_PORT,
+            this->config.receiveShards, this->config.backend == IoUringBackend ? "io_uring" : "classic");
+        broadcaster = std::make_unique<BroadcastEngine>(serverSocket, BROADCAST_USE_GSO, this->config.backend == IoUringBackend);
+        metricsExporter = std::make_unique<MetricsExporter>(metricsRegistry, this->config.metricsPort,
+            this->config.metricsFile, this->config.metricsFileInterval);
+        if (!this->config.capturePath.empty()) {
+            capture = std::make_unique<CaptureWriter>(this->config.capturePath, captureSettings());
+            LOG_INFO("Capturing inbound datagrams to {}", this->config.capturePath.c_str());
+        }
     }
     catch (const std::system_error& e) {
         std::cerr << "System error during server initialization: " << e.what() << std::endl;
@@ -16,173 +108,1434 @@ Server::Server() {
 }
 
 Server::~Server() {
-    if (receiverThread.joinable()) {
-        receiverThread.join();
+    if (senderThread.joinable()) {
+        senderThread.join();
+    }
+    for (std::thread& receiverThread : receiverThreads) {
+        if (receiverThread.joinable()) {
+            receiverThread.join();
+        }
+    }
+#ifdef __linux__
+    for (int epollFd : epollFds) {
+        if (epollFd != -1) {
+            close(epollFd);
+        }
     }
-    closesocket(serverSocket);
+#endif
+    for (SOCKET socket : receiveSockets) {
+        closesocket(socket);
+    }
+#ifdef _WIN32
     WSACleanup();
+#endif
 }
 
 void Server::run() {
-    receiverThread = std::thread(&Server::receiveData, this);
+    if (!config.replayPath.empty()) {
+        runReplay();
+        return;
+    }
 
-    auto previousTime = std::chrono::high_resolution_clock::now();
-    double lag = 0.0;
+#ifdef __linux__
+    epollFds.assign(config.receiveShards, -1);
+#endif
+    for (int shard = 0; shard < config.receiveShards; ++shard) {
+        receiverThreads.emplace_back(&Server::receiveData, this, shard);
+    }
+    senderThread = std::thread(&Server::sendLoop, this);
 
     while (true) {
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed = currentTime - previousTime;
-        previousTime = currentTime;
-        lag += elapsed.count();
-
-        while (lag >= tickRate) {
-            try {
-                {
-                    std::lock_guard<std::mutex> guard(mutex);
-                    sendMovementUpdates();
-                }
-                checkHeartbeats(); // Check for players who have timed out
-                lag -= tickRate;
+        // Nobody to send to, so tick just often enough to admit new connections
+        tickScheduler.setInterval(playerTable.size() == 0 ? 1.0 / IDLE_TICK_RATE : tickRate);
+        auto lateness = tickScheduler.waitForNextTick();
+        metrics.tickLateness.recordDuration(lateness);
+
+        try {
+            auto tickStart = std::chrono::steady_clock::now();
+            tickCount++;
+            tickStartedAt = tickStart - lateness;
+            drainInboundCommands();
+            simulatePlayers();
+            publishSnapshot();
+            processTimers();
+
+            auto tickEnd = std::chrono::steady_clock::now();
+            std::chrono::duration<double> tickDuration = tickEnd - tickStart;
+            metrics.tickDuration.recordDuration(tickEnd - tickStart);
+            metrics.connectedClients.set(static_cast<double>(playerTable.size()));
+            metrics.timersPending.set(static_cast<double>(timers.pending()));
+            ticksSinceReport++;
+            tickDurationTotal += tickDuration.count();
+            if (tickDuration.count() > tickDurationMax) {
+                tickDurationMax = tickDuration.count();
             }
-            catch (const std::system_error& e) {
-                std::cerr << "System error during server tick: " << e.what() << std::endl;
-                // Handle the error, potentially break the loop or continue
+
+            if (tickStart - lastStatsReport >= std::chrono::duration<double>(STATS_INTERVAL)) {
+                reportNetworkStats();
             }
         }
+        catch (const std::system_error& e) {
+            LOG_ERROR_RATE(1, "System error during server tick: {}", e.what());
+            // Handle the error, potentially break the loop or continue
+        }
     }
 }
 
+// Replays a capture through the same decode, drain, publish, timer and send
+// steps as run(), on one thread and without sockets. Each datagram is fed to
+// the tick that drained it originally and ticks keep their original numbers,
+// so snapshot acks still name the baselines they did live and the same file
+// always produces the same ticks. Game time follows the capture timestamps.
+void Server::runReplay() {
+    enum ReplayStage {
+        DecodeStage,
+        DrainStage,
+        SimulateStage,
+        PublishStage,
+        TimerStage,
+        SendStage,
+        ReplayStageCount,
+    };
+    static const char* stageNames[ReplayStageCount] = { "decode", "drain", "simulate", "publish", "timers", "send" };
+
+    CaptureReader& reader = *replayReader;
+    LOG_INFO("Replaying {} {}", config.replayPath.c_str(), config.replayRealTime ? "at captured pacing" : "as fast as possible");
+
+    std::unique_ptr<Histogram[]> stageTimes = std::make_unique<Histogram[]>(ReplayStageCount);
+    std::unique_ptr<CapturedDatagram> datagram = std::make_unique<CapturedDatagram>();
+    std::unique_ptr<IncomingPacket> packet = std::make_unique<IncomingPacket>();
+    auto epoch = std::chrono::steady_clock::now();
+    uint64_t datagramCount = 0;
+    uint64_t firstTick = 0;
+    bool pending = reader.next(*datagram);
+    if (pending) {
+        firstTick = tickCount = datagram->tick;
+    }
+    replaying = true;
+    replayTime = epoch;
+
+    while (pending) {
+        if (config.replayRealTime) {
+            tickScheduler.setInterval(playerTable.size() == 0 ? 1.0 / IDLE_TICK_RATE : tickRate);
+            tickScheduler.waitForNextTick();
+        }
+
+        auto stageStart = std::chrono::steady_clock::now();
+        while (pending && datagram->tick <= tickCount) {
+            std::memset(packet.get(), 0, sizeof(IncomingPacket));
+            std::memcpy(packet.get(), datagram->data, std::min<size_t>(datagram->length, sizeof(IncomingPacket)));
+
+            replayTime = epoch + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(datagram->timestamp));
+            handleDatagram(0, *packet, static_cast<int>(std::min<size_t>(datagram->length, sizeof(IncomingPacket))), datagram->address, replayTime);
+            datagramCount++;
+            pending = reader.next(*datagram);
+        }
+        auto stageEnd = std::chrono::steady_clock::now();
+        stageTimes[DecodeStage].recordDuration(stageEnd - stageStart);
+
+        tickCount++;
+        tickStartedAt = gameClock();
+        stageStart = stageEnd;
+        drainInboundCommands();
+        stageEnd = std::chrono::steady_clock::now();
+        stageTimes[DrainStage].recordDuration(stageEnd - stageStart);
+
+        stageStart = stageEnd;
+        simulatePlayers();
+        stageEnd = std::chrono::steady_clock::now();
+        stageTimes[SimulateStage].recordDuration(stageEnd - stageStart);
+
+        stageStart = stageEnd;
+        publishSnapshot();
+        stageEnd = std::chrono::steady_clock::now();
+        stageTimes[PublishStage].recordDuration(stageEnd - stageStart);
+
+        stageStart = stageEnd;
+        processTimers();
+        stageEnd = std::chrono::steady_clock::now();
+        stageTimes[TimerStage].recordDuration(stageEnd - stageStart);
+
+        stageStart = stageEnd;
+        if (snapshots.consume()) {
+            sendMovementUpdates(snapshots.readBuffer());
+        }
+        stageEnd = std::chrono::steady_clock::now();
+        stageTimes[SendStage].recordDuration(stageEnd - stageStart);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - epoch;
+    uint64_t ticks = tickCount - firstTick;
+    LOG_INFO("Replayed {} datagrams in {} ticks over {} s, {} ticks/sec, {} players at the end",
+        datagramCount, ticks, elapsed.count(), ticks / elapsed.count(), playerTable.size());
+
+    std::unique_ptr<Histogram::Snapshot> times = std::make_unique<Histogram::Snapshot>();
+    for (int stage = 0; stage < ReplayStageCount; ++stage) {
+        stageTimes[stage].snapshot(*times);
+        LOG_INFO("  {} avg {} ms, p50 {} ms, p99 {} ms, max {} ms", stageNames[stage],
+            times->count > 0 ? times->sum / 1e6 / times->count : 0.0, times->valueAtQuantile(0.5) / 1e6,
+            times->valueAtQuantile(0.99) / 1e6, times->max / 1e6);
+    }
+
+    LOG_INFO("Encoded {} delta / {} full snapshots in {} datagrams, {} bytes",
+        deltaSnapshotsSent.load(), fullSnapshotsSent.load(), metrics.packetsSent.load(), metrics.bytesSent.load());
+    Logger::instance().flush();
+    replaying = false;
+}
+
+CaptureSettings Server::captureSettings() const {
+    CaptureSettings settings{};
+    settings.spawnArea = config.spawnArea;
+    settings.snapshotRate = config.snapshotRate;
+    settings.clientPacketRate = config.clientPacketRate;
+    settings.clientPacketBurst = config.clientPacketBurst;
+    settings.adaptiveSendRate = config.adaptiveSendRate ? 1 : 0;
+    return settings;
+}
+
+// A replay only reproduces the recorded run with the recorded settings, so they
+// win over the command line; any that differ are reported
+void Server::applyCaptureSettings(const CaptureSettings& settings) {
+    if (settings.spawnArea != config.spawnArea) {
+        LOG_WARN("Replaying with the captured spawn area {}, not {}", settings.spawnArea, config.spawnArea);
+        config.spawnArea = settings.spawnArea;
+    }
+    if (settings.snapshotRate != config.snapshotRate) {
+        LOG_WARN("Replaying with the captured snapshot rate {}, not {}", settings.snapshotRate, config.snapshotRate);
+        config.snapshotRate = settings.snapshotRate;
+    }
+    if (settings.clientPacketRate != config.clientPacketRate || settings.clientPacketBurst != config.clientPacketBurst) {
+        LOG_WARN("Replaying with the captured client rate {} and burst {}, not {} and {}", settings.clientPacketRate,
+            settings.clientPacketBurst, config.clientPacketRate, config.clientPacketBurst);
+        config.clientPacketRate = settings.clientPacketRate;
+        config.clientPacketBurst = settings.clientPacketBurst;
+    }
+    if ((settings.adaptiveSendRate != 0) != config.adaptiveSendRate) {
+        LOG_WARN("Replaying with the captured {} send rate", settings.adaptiveSendRate != 0 ? "adaptive" : "fixed");
+        config.adaptiveSendRate = settings.adaptiveSendRate != 0;
+    }
+}
+
+std::chrono::steady_clock::time_point Server::gameClock() const {
+    return replaying ? replayTime : std::chrono::steady_clock::now();
+}
+
+int64_t Server::serverMicros(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
 void Server::initializeWinSock() {
+#ifdef _WIN32
     WSADATA wsaData;
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
         std::cerr << "WSAStartup failed." << std::endl;
         throw std::system_error(WSAGetLastError(), std::system_category(), "WSAStartup failed");
     }
+#endif
 }
 
-void Server::createSocket() {
-    serverSocket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (serverSocket == INVALID_SOCKET) {
+SOCKET Server::createSocket() {
+    SOCKET socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket == INVALID_SOCKET) {
         std::cerr << "Socket creation failed." << std::endl;
+        int errorCode = lastSocketError();
+#ifdef _WIN32
         WSACleanup();
-        throw std::system_error(WSAGetLastError(), std::system_category(), "Socket creation failed");
+#endif
+        throw std::system_error(errorCode, std::system_category(), "Socket creation failed");
     }
+
+#ifdef __linux__
+    if (config.receiveShards > 1) {
+        // Every shard binds the same port; the kernel hashes each client's
+        // address/port 4-tuple to one socket, so a client always lands on the
+        // same shard and its packets stay in order.
+        int enable = 1;
+        if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) == SOCKET_ERROR) {
+            int errorCode = lastSocketError();
+            closesocket(socket);
+            throw std::system_error(errorCode, std::system_category(), "SO_REUSEPORT failed");
+        }
+    }
+#endif
+    return socket;
 }
 
-void Server::bindSocket() {
+void Server::bindSocket(SOCKET socket) {
     serverAddr.sin_family = AF_INET;
     serverAddr.sin_addr.s_addr = INADDR_ANY;
     serverAddr.sin_port = htons(SERVER_PORT);
-    if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
+    if (bind(socket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
         std::cerr << "Bind failed." << std::endl;
-        closesocket(serverSocket);
+        int errorCode = lastSocketError();
+        for (SOCKET openSocket : receiveSockets) {
+            closesocket(openSocket);
+        }
+#ifdef _WIN32
         WSACleanup();
-        throw std::system_error(WSAGetLastError(), std::system_category(), "Bind failed");
+#endif
+        throw std::system_error(errorCode, std::system_category(), "Bind failed");
     }
-    std::cout << "UDP server is listening on port " << SERVER_PORT << "..." << std::endl;
 }
 
-void Server::receiveData() {
+void Server::receiveData(int shard) {
+#ifdef __linux__
+#ifdef HAS_IO_URING
+    if (config.backend == IoUringBackend && receiveDataIoUring(shard)) {
+        return;
+    }
+#endif
+    receiveDataBatched(shard);
+#else
     struct sockaddr_in clientAddr;
-    int clientAddrLen = sizeof(clientAddr);
-    char buffer[BUFFER_SIZE] = { 0 };
+    socklen_t clientAddrLen = sizeof(clientAddr);
 
     while (true) {
         IncomingPacket packet;
-        int bytesReceived = recvfrom(serverSocket, (char*)&packet, sizeof(IncomingPacket), 0, (struct sockaddr*)&clientAddr, &clientAddrLen);
+        int bytesReceived = recvfrom(receiveSockets[shard], (char*)&packet, sizeof(IncomingPacket), 0, (struct sockaddr*)&clientAddr, &clientAddrLen);
 
         if (bytesReceived == SOCKET_ERROR) {
-            int errorCode = WSAGetLastError();
+            int errorCode = lastSocketError();
+#ifdef _WIN32
             if (errorCode == WSAECONNRESET) {
-                handleClientDisconnect(clientAddr);
+                InboundCommand command{};
+                command.kind = InboundCommand::Disconnect;
+                command.clientAddr = clientAddr;
+                command.receivedAt = std::chrono::steady_clock::now();
+                enqueueCommand(command, shard);
+                continue;
             }
-            else {
-                std::cerr << "recvfrom failed with error code: " << errorCode << std::endl;
+#endif
+            LOG_WARN_RATE(1, "recvfrom failed with error code: {}", errorCode);
+            continue;
+        }
+
+        shardStats[shard].wakeups.fetch_add(1, std::memory_order_relaxed);
+        shardStats[shard].datagrams.fetch_add(1, std::memory_order_relaxed);
+        metrics.packetsReceived.add();
+        metrics.bytesReceived.add(bytesReceived);
+        shardStats[shard].maxPerWakeup.store(1, std::memory_order_relaxed);
+
+        auto receivedAt = std::chrono::steady_clock::now();
+        if (capture) {
+            capture->record(clientAddr, &packet, bytesReceived, receivedAt, static_cast<uint32_t>(publishedTick.load(std::memory_order_relaxed)));
+        }
+
+        handleDatagram(shard, packet, bytesReceived, clientAddr, receivedAt);
+    }
+#endif
+}
+
+#ifdef __linux__
+void Server::pinReceiveThread(int shard) {
+    unsigned int cores = std::thread::hardware_concurrency();
+    if (!config.pinReceiveThreads || cores == 0) {
+        return;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(shard % cores, &cpuSet);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (result != 0) {
+        std::cerr << "Failed to pin receive shard " << shard << " with error code: " << result << std::endl;
+    }
+}
+
+void Server::receiveDataBatched(int shard) {
+    pinReceiveThread(shard);
+
+    SOCKET socket = receiveSockets[shard];
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+
+    int epollFd = epoll_create1(0);
+    if (epollFd == -1) {
+        throw std::system_error(errno, std::system_category(), "epoll_create1 failed");
+    }
+    epollFds[shard] = epollFd;
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = socket;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) == -1) {
+        throw std::system_error(errno, std::system_category(), "epoll_ctl failed");
+    }
+
+    // One allocation for the lifetime of the thread; recvmmsg writes straight into these slots
+    std::unique_ptr<ReceiveRing> ring = std::make_unique<ReceiveRing>();
+    for (int i = 0; i < RECV_BATCH_SIZE; ++i) {
+        ring->iovecs[i].iov_base = &ring->packets[i];
+        ring->iovecs[i].iov_len = sizeof(IncomingPacket);
+    }
+
+    while (true) {
+        epoll_event ready;
+        int readyCount = epoll_wait(epollFd, &ready, 1, -1);
+        if (readyCount == -1) {
+            if (errno != EINTR) {
+                LOG_WARN_RATE(1, "epoll_wait failed with error code: {}", errno);
             }
             continue;
         }
 
-        std::lock_guard<std::mutex> guard(mutex);
-        clients.insert(clientAddr);
+        uint64_t datagramsThisWakeup = 0;
+        uint64_t bytesThisWakeup = 0;
 
-        try {
-            processIncomingPacket(packet, clientAddr);
+        // Drain the socket until it would block so one wakeup covers every queued datagram
+        while (true) {
+            for (int i = 0; i < RECV_BATCH_SIZE; ++i) {
+                std::memset(&ring->headers[i].msg_hdr, 0, sizeof(msghdr));
+                ring->headers[i].msg_hdr.msg_name = &ring->addrs[i];
+                ring->headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                ring->headers[i].msg_hdr.msg_iov = &ring->iovecs[i];
+                ring->headers[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int received = recvmmsg(socket, ring->headers, RECV_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            if (received == -1) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    LOG_WARN_RATE(1, "recvmmsg failed with error code: {}", errno);
+                }
+                break;
+            }
+
+            auto receivedAt = std::chrono::steady_clock::now();
+            for (int i = 0; i < received; ++i) {
+                bytesThisWakeup += ring->headers[i].msg_len;
+                if (capture) {
+                    capture->record(ring->addrs[i], &ring->packets[i], static_cast<int>(ring->headers[i].msg_len), receivedAt,
+                        static_cast<uint32_t>(publishedTick.load(std::memory_order_relaxed)));
+                }
+                handleDatagram(shard, ring->packets[i], static_cast<int>(ring->headers[i].msg_len), ring->addrs[i], receivedAt);
+            }
+
+            datagramsThisWakeup += received;
+            if (received < RECV_BATCH_SIZE) {
+                break;
+            }
         }
-        catch (const std::system_error& e) {
-            std::cerr << "Error processing incoming packet: " << e.what() << std::endl;
-            // Handle specific packet processing errors if necessary
+
+        if (datagramsThisWakeup == 0) {
+            continue;
+        }
+
+        ReceiveShardStats& stats = shardStats[shard];
+        stats.wakeups.fetch_add(1, std::memory_order_relaxed);
+        stats.datagrams.fetch_add(datagramsThisWakeup, std::memory_order_relaxed);
+        metrics.packetsReceived.add(datagramsThisWakeup);
+        metrics.bytesReceived.add(bytesThisWakeup);
+        uint64_t previousMax = stats.maxPerWakeup.load(std::memory_order_relaxed);
+        while (datagramsThisWakeup > previousMax &&
+            !stats.maxPerWakeup.compare_exchange_weak(previousMax, datagramsThisWakeup, std::memory_order_relaxed)) {
         }
     }
 }
+#endif
 
-void Server::handleClientDisconnect(const sockaddr_in& clientAddr) {
-    std::lock_guard<std::mutex> guard(mutex);
-    clients.erase(clientAddr);
-    for (auto it = playerPositions.begin(); it != playerPositions.end(); ++it) {
-        if (clientAddr.sin_port == it->first) {
-            playerPositions.erase(it);
-            break;
+#ifdef HAS_IO_URING
+// One multishot recvmsg stays armed on the socket and completes once per
+// datagram into a buffer the kernel picks from the shard's provided ring, so
+// a wakeup costs one io_uring_enter however many datagrams it reaps. Returns
+// false if the kernel rejects multishot receive, leaving the caller to fall
+// back to recvmmsg.
+bool Server::receiveDataIoUring(int shard) {
+    pinReceiveThread(shard);
+
+    // Each buffer holds the recvmsg header, the source address and the datagram
+    const unsigned bufferSize = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + sizeof(IncomingPacket);
+    IoUring ring(IO_URING_QUEUE_DEPTH);
+    ring.registerBufferRing(0, IO_URING_RECV_BUFFERS, bufferSize);
+
+    msghdr receiveHeader{};
+    receiveHeader.msg_namelen = sizeof(sockaddr_in);
+    bool armed = false;
+    uint64_t datagramsTotal = 0;
+
+    while (true) {
+        if (!armed) {
+            io_uring_sqe* sqe = ring.getSqe();
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->fd = receiveSockets[shard];
+            sqe->addr = reinterpret_cast<uint64_t>(&receiveHeader);
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = 0;
+            armed = true;
+        }
+
+        int result = ring.submit(1);
+        if (result < 0 && result != -EINTR) {
+            LOG_WARN_RATE(1, "io_uring_enter failed with error code: {}", -result);
+            continue;
+        }
+
+        auto receivedAt = std::chrono::steady_clock::now();
+        uint64_t datagramsThisWakeup = 0;
+        uint64_t bytesThisWakeup = 0;
+        io_uring_cqe* cqe;
+        while ((cqe = ring.peekCqe()) != nullptr) {
+            int res = cqe->res;
+            uint32_t flags = cqe->flags;
+            ring.seen();
+
+            // Without F_MORE the multishot request has ended, e.g. when the buffer ring ran dry
+            if (!(flags & IORING_CQE_F_MORE)) {
+                armed = false;
+            }
+            if (res < 0) {
+                if (res == -EINVAL && datagramsTotal == 0) {
+                    LOG_WARN("Shard {} kernel rejected multishot receive; using recvmmsg instead", shard);
+                    return false;
+                }
+                if (res != -ENOBUFS) {
+                    LOG_WARN_RATE(1, "io_uring receive failed with error code: {}", -res);
+                }
+                continue;
+            }
+            if (!(flags & IORING_CQE_F_BUFFER)) {
+                continue;
+            }
+
+            uint16_t bufferId = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+            unsigned char* buffer = ring.buffer(bufferId);
+            const io_uring_recvmsg_out* out = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+            const sockaddr_in* clientAddr = reinterpret_cast<const sockaddr_in*>(out + 1);
+            const IncomingPacket* packet = reinterpret_cast<const IncomingPacket*>(
+                reinterpret_cast<const unsigned char*>(clientAddr) + receiveHeader.msg_namelen + receiveHeader.msg_controllen);
+            int length = static_cast<int>(std::min<size_t>(out->payloadlen, sizeof(IncomingPacket)));
+
+            datagramsThisWakeup++;
+            bytesThisWakeup += length;
+            if (capture) {
+                capture->record(*clientAddr, packet, length, receivedAt, static_cast<uint32_t>(publishedTick.load(std::memory_order_relaxed)));
+            }
+
+            handleDatagram(shard, *packet, length, *clientAddr, receivedAt);
+            ring.recycleBuffer(bufferId);
+        }
+        ring.commitBuffers();
+
+        if (datagramsThisWakeup == 0) {
+            continue;
+        }
+        datagramsTotal += datagramsThisWakeup;
+
+        ReceiveShardStats& stats = shardStats[shard];
+        stats.wakeups.fetch_add(1, std::memory_order_relaxed);
+        stats.datagrams.fetch_add(datagramsThisWakeup, std::memory_order_relaxed);
+        metrics.packetsReceived.add(datagramsThisWakeup);
+        metrics.bytesReceived.add(bytesThisWakeup);
+        uint64_t previousMax = stats.maxPerWakeup.load(std::memory_order_relaxed);
+        while (datagramsThisWakeup > previousMax &&
+            !stats.maxPerWakeup.compare_exchange_weak(previousMax, datagramsThisWakeup, std::memory_order_relaxed)) {
         }
     }
-    std::cout << "Client disconnected. Removed from the list of players." << std::endl;
 }
+#endif
 
-void Server::checkHeartbeats() {
-    std::lock_guard<std::mutex> guard(mutex); // Ensure thread safety
+void Server::reportNetworkStats() {
+    if (capture) {
+        capture->flush();
+    }
 
     auto now = std::chrono::steady_clock::now();
-    auto it = playerPositions.begin();
+    std::chrono::duration<double> interval = now - lastStatsReport;
+    lastStatsReport = now;
 
-    while (it != playerPositions.end()) {
-        std::chrono::duration<double> elapsed = now - it->second.lastKeepAlive;
-        std::cout << "Client " << it->first << " last heartbeat was " << elapsed.count() << " seconds ago.\n";
-        if (elapsed.count() > HEARTBEAT_TIMEOUT) {
-            std::cout << "Client " << it->first << " timed out due to no heartbeat.\n";
-            it = playerPositions.erase(it); // Remove player from the list
+    uint64_t totalDatagrams = 0;
+    for (int shard = 0; shard < config.receiveShards; ++shard) {
+        ReceiveShardStats& stats = shardStats[shard];
+        uint64_t wakeups = stats.wakeups.exchange(0, std::memory_order_relaxed);
+        uint64_t datagrams = stats.datagrams.exchange(0, std::memory_order_relaxed);
+        uint64_t maxPerWakeup = stats.maxPerWakeup.exchange(0, std::memory_order_relaxed);
+        uint64_t dropped = stats.dropped.exchange(0, std::memory_order_relaxed);
+        uint64_t rateLimited = stats.rateLimited.exchange(0, std::memory_order_relaxed);
+        uint64_t malformed = stats.malformed.exchange(0, std::memory_order_relaxed);
+        totalDatagrams += datagrams;
+        if (dropped > 0) {
+            LOG_WARN("Shard {} dropped {} commands on a full inbound queue", shard, dropped);
         }
-        else {
-            ++it;
+        if (rateLimited > 0 || malformed > 0) {
+            LOG_WARN("Shard {} dropped {} rate limited and {} malformed datagrams", shard, rateLimited, malformed);
         }
+        if (wakeups > 0) {
+            LOG_INFO("Shard {} received {} datagrams in {} wakeups ({} per wakeup, max {})",
+                shard, datagrams, wakeups, static_cast<double>(datagrams) / wakeups, maxPerWakeup);
+        }
+    }
+    if (totalDatagrams > 0) {
+        LOG_INFO("Receive rate {} packets/sec across {} shard(s)",
+            static_cast<uint64_t>(totalDatagrams / interval.count()), config.receiveShards);
+    }
+
+    if (drainedCommands > 0) {
+        LOG_INFO("Drained {} commands (max queue depth {}, drain latency avg {} ms, max {} ms)",
+            drainedCommands, maxQueueDepth, drainLatencyTotal / drainedCommands * 1000.0, drainLatencyMax * 1000.0);
+    }
+    if (inputsApplied > 0 || inputsLate > 0) {
+        LOG_INFO("Simulated {} inputs, {} arrived late", inputsApplied, inputsLate);
+    }
+    inputsApplied = 0;
+    inputsLate = 0;
+    drainedCommands = 0;
+    maxQueueDepth = 0;
+    drainLatencyTotal = 0.0;
+    drainLatencyMax = 0.0;
+
+    uint64_t sendTicks = broadcastTicks.exchange(0, std::memory_order_relaxed);
+    uint64_t sendSyscalls = broadcastSyscalls.exchange(0, std::memory_order_relaxed);
+    uint64_t sendBytes = broadcastBytes.exchange(0, std::memory_order_relaxed);
+    uint64_t skipped = snapshotsSkipped.exchange(0, std::memory_order_relaxed);
+    uint64_t fullSnapshots = fullSnapshotsSent.exchange(0, std::memory_order_relaxed);
+    uint64_t deltaSnapshots = deltaSnapshotsSent.exchange(0, std::memory_order_relaxed);
+    uint64_t snapshotParts = snapshotPartsSent.exchange(0, std::memory_order_relaxed);
+    uint64_t deferred = snapshotsDeferred.exchange(0, std::memory_order_relaxed);
+    if (sendTicks > 0) {
+        LOG_INFO("Broadcast {} syscalls and {} bytes per tick{}, {} snapshots skipped, {} delta / {} full in {} datagrams, {} deferred by congestion control",
+            static_cast<double>(sendSyscalls) / sendTicks, static_cast<double>(sendBytes) / sendTicks,
+            broadcaster->gsoEnabled() ? " (GSO on)" : "", skipped, deltaSnapshots, fullSnapshots, snapshotParts, deferred);
+    }
+
+    uint64_t late = latePackets;
+    uint64_t duplicates = duplicatePackets;
+    uint64_t acked = datagramsAcked.exchange(0, std::memory_order_relaxed);
+    uint64_t lost = datagramsLost.exchange(0, std::memory_order_relaxed);
+    uint64_t samples = rttSamples.exchange(0, std::memory_order_relaxed);
+    uint64_t rttMicros = rttTotalMicros.exchange(0, std::memory_order_relaxed);
+    latePackets = 0;
+    duplicatePackets = 0;
+    if (acked + lost > 0 || late + duplicates > 0) {
+        LOG_INFO("Clients acked {} datagrams, lost {} ({}% loss), RTT avg {} ms; rejected {} late and {} duplicate packets",
+            acked, lost, 100.0 * lost / std::max<uint64_t>(acked + lost, 1), samples > 0 ? rttMicros / 1000.0 / samples : 0.0,
+            late, duplicates);
+    }
+
+    TickScheduler::Stats pacing = tickScheduler.takeStats();
+    if (pacing.ticks > 0) {
+        LOG_INFO("Tick jitter avg {} ms, max {} ms at {} Hz, {} ticks skipped, spin margin {} ms",
+            pacing.latenessTotal / pacing.ticks * 1000.0, pacing.latenessMax * 1000.0,
+            1.0 / tickScheduler.interval(), pacing.ticksSkipped, tickScheduler.spinMargin() * 1000.0);
     }
+
+    if (ticksSinceReport > 0) {
+        LOG_INFO("Tick time avg {} ms, max {} ms", tickDurationTotal / ticksSinceReport * 1000.0, tickDurationMax * 1000.0);
+        LOG_INFO("Timers fired avg {} per tick, max {}, {} pending",
+            static_cast<double>(timersFired) / ticksSinceReport, timersFiredMax, timers.pending());
+    }
+    ticksSinceReport = 0;
+    timersFired = 0;
+    timersFiredMax = 0;
+    tickDurationTotal = 0.0;
+    tickDurationMax = 0.0;
 }
 
-void Server::processIncomingPacket(const IncomingPacket& packet, const sockaddr_in& clientAddr) {
-    auto now = std::chrono::steady_clock::now();
+// Everything a receiver does with one datagram once it is captured. The
+// cheapest rejections come first: a flooding address is dropped before its
+// bytes are looked at, a datagram too short for its type before decoding.
+void Server::handleDatagram(int shard, const IncomingPacket& packet, int length, const sockaddr_in& clientAddr,
+    std::chrono::steady_clock::time_point receivedAt) {
+    if (!rateLimiters[shard].allow(clientAddr, receivedAt)) {
+        shardStats[shard].rateLimited.fetch_add(1, std::memory_order_relaxed);
+        metrics.packetsRateLimited.add();
+        return;
+    }
 
+    InboundCommand command;
+    if (!decodePacket(packet, length, clientAddr, receivedAt, command)) {
+        shardStats[shard].malformed.fetch_add(1, std::memory_order_relaxed);
+        metrics.packetsMalformed.add();
+        return;
+    }
+    enqueueCommand(command, shard);
+}
+
+bool Server::decodePacket(const IncomingPacket& packet, int length, const sockaddr_in& clientAddr,
+    std::chrono::steady_clock::time_point receivedAt, InboundCommand& command) const {
+    // Header, type, slot, generation and snapshot ack, then only the union member the type uses
+    const size_t fixedSize = offsetof(IncomingPacket, movementData);
+    if (length < static_cast<int>(fixedSize)) {
+        return false;
+    }
+
+    size_t payloadSize = 0;
+    command.kind = InboundCommand::Update;
+    command.inputCount = 0;
+    command.hasViewRadius = false;
+    command.hasTimeSync = false;
     switch (packet.type) {
+    case ClientUpdate:
+        if (!decodeUpdateRecords(packet, length - fixedSize, command)) {
+            LOG_DEBUG_RATE(10, "Received malformed update from slot {}", packet.slot);
+            return false;
+        }
+        break;
     case PlayerMovementUpdates:
-        playerPositions[packet.clientId].x = packet.movementData.x;
-        playerPositions[packet.clientId].y = packet.movementData.y;
-        playerPositions[packet.clientId].lastKeepAlive = now;
-        // std::cout << "Updated position for client " << packet.clientId
-        //     << " to (" << packet.movementData.x << ", " << packet.movementData.y << ")\n";
+        // Movement is simulated from inputs now; a client's own idea of its position only keeps the session alive
+        payloadSize = sizeof(packet.movementData);
         break;
     case heartBeat:
-        playerPositions[packet.clientId].lastKeepAlive = now;
-        // std::cout << "Received heartbeat from client " << packet.clientId << "\n";
+        payloadSize = sizeof(packet.heartBeat);
         break;
-    default:
-        // std::cerr << "Received unknown packet type from client " << packet.clientId << "\n";
+    case ViewRadius:
+        command.hasViewRadius = true;
+        command.viewRadius = packet.viewData.radius;
+        payloadSize = sizeof(packet.viewData);
+        break;
+    case Connect:
+        command.kind = InboundCommand::Connect;
         break;
+    default:
+        LOG_DEBUG_RATE(10, "Received unknown packet type {} from slot {}", packet.type, packet.slot);
+        return false;
+    }
+
+    // Fields past the end were never sent; the receive buffer still holds whatever came before
+    if (length < static_cast<int>(fixedSize + payloadSize)) {
+        LOG_DEBUG_RATE(10, "Received truncated packet of type {}, {} bytes", packet.type, length);
+        return false;
+    }
+
+    // A NaN radius would reach the grid query through std::clamp; the rest of the packet still counts
+    if (command.hasViewRadius && !std::isfinite(command.viewRadius)) {
+        LOG_DEBUG_RATE(10, "Rejected non-finite view radius from slot {}", packet.slot);
+        command.hasViewRadius = false;
+        metrics.packetsRejected.add();
+    }
+
+    command.header = packet.header;
+    command.slot = packet.slot;
+    command.generation = packet.generation;
+    command.snapshotAck = packet.snapshotAck;
+    command.clientAddr = clientAddr;
+    command.receivedAt = receivedAt;
+    return true;
+}
+
+// Folds every record of a ClientUpdate into one command; a later record of the same kind wins
+bool Server::decodeUpdateRecords(const IncomingPacket& packet, size_t recordBytes, InboundCommand& command) const {
+    BitReader reader(packet.records, std::min(recordBytes, sizeof(packet.records)));
+    uint32_t recordCount = reader.readBits(UPDATE_RECORD_COUNT_BITS);
+    for (uint32_t i = 0; i < recordCount && !reader.overflowed(); ++i) {
+        switch (reader.readBits(UPDATE_RECORD_TAG_BITS)) {
+        case InputRecord: {
+            // Inputs count back from the newest, so there can be no more of them than its tick
+            uint32_t inputTick = reader.readBits(32);
+            uint32_t inputCount = reader.readBits(INPUT_COUNT_BITS);
+            if (inputCount > INPUT_REDUNDANCY || inputCount > inputTick) {
+                return false;
+            }
+            for (uint32_t input = 0; input < inputCount; ++input) {
+                command.inputs[input] = static_cast<uint8_t>(reader.readBits(INPUT_BUTTON_BITS));
+            }
+            command.inputTick = inputTick;
+            command.inputCount = static_cast<uint8_t>(inputCount);
+            break;
+        }
+        case ViewRadiusRecord: {
+            uint32_t radius = reader.readBits(32);
+            std::memcpy(&command.viewRadius, &radius, sizeof(float));
+            command.hasViewRadius = true;
+            break;
+        }
+        case ChatRecord: {
+            // Chat is not relayed yet; skip over the text
+            uint32_t chatLength = reader.readBits(8);
+            for (uint32_t c = 0; c < chatLength; ++c) {
+                reader.readBits(8);
+            }
+            break;
+        }
+        case TimeSyncRecord:
+            command.syncRequestedAt = reader.readBits(32);
+            command.hasTimeSync = true;
+            break;
+        default:
+            return false;
+        }
     }
+    return !reader.overflowed();
 }
 
-void Server::sendMovementUpdates() {
-    OutgoingPacket outgoingPacket;
-    outgoingPacket.type = PlayerMovementUpdates;
-    outgoingPacket.movementUpdates.numPlayers = 0;
+void Server::enqueueCommand(const InboundCommand& command, int shard) {
+    if (!inboundCommands.tryPush(command)) {
+        // The tick has fallen behind; shed load here rather than block the receiver
+        shardStats[shard].dropped.fetch_add(1, std::memory_order_relaxed);
+        metrics.commandsDropped.add();
+    }
+}
+
+void Server::drainInboundCommands() {
+    auto drainStart = std::chrono::steady_clock::now();
 
-    for (const auto& [id, position] : playerPositions) {
-        if (outgoingPacket.movementUpdates.numPlayers < MAX_PLAYERS) {
-            outgoingPacket.movementUpdates.players[outgoingPacket.movementUpdates.numPlayers++] = { id, position.x, position.y };
+    // Only drain what was queued when the tick started so a flood cannot stall the tick
+    size_t depth = inboundCommands.size();
+    metrics.inboundQueueDepth.set(static_cast<double>(depth));
+    InboundCommand command;
+    for (size_t i = 0; i < depth && inboundCommands.tryPop(command); ++i) {
+        std::chrono::duration<double> latency = drainStart - command.receivedAt;
+        metrics.commandLatency.recordDuration(drainStart - command.receivedAt);
+        drainLatencyTotal += latency.count();
+        if (latency.count() > drainLatencyMax) {
+            drainLatencyMax = latency.count();
+        }
+        drainedCommands++;
+
+        try {
+            processIncomingPacket(command);
         }
+        catch (const std::system_error& e) {
+            LOG_ERROR_RATE(1, "Error processing incoming packet: {}", e.what());
+        }
+    }
+
+    if (depth > maxQueueDepth) {
+        maxQueueDepth = depth;
     }
+}
+
+void Server::handleClientConnect(const InboundCommand& command) {
+    // A retried connect gets the slot it was already given
+    int existing = slotsByAddress.find(command.clientAddr);
+    if (existing >= 0) {
+        int slot = existing;
+        // The client starts numbering packets and inputs from scratch after a handshake
+        playerTable.receiveWindow[slot].reset();
+        playerTable.inputs[slot].reset();
+        pendingAccepts.push_back({ command.clientAddr, static_cast<uint16_t>(slot), playerTable.generation[slot],
+            playerTable.x[slot], playerTable.y[slot] });
+        return;
+    }
+
+    int slot = playerTable.allocate(command.clientAddr, command.receivedAt);
+    if (slot < 0) {
+        LOG_WARN_RATE(1, "Rejected connection, all {} player slots are in use.", MAX_PLAYER_SLOTS);
+        return;
+    }
+
+    if (config.spawnArea > 0.0f) {
+        std::uniform_real_distribution<float> spawn(0.0f, config.spawnArea);
+        playerTable.x[slot] = spawn(spawnRng);
+        playerTable.y[slot] = spawn(spawnRng);
+    }
+    playerTable.viewRadius[slot] = DEFAULT_VIEW_RADIUS;
+    slotsByAddress.insert(command.clientAddr, slot);
+    grid.insert(slot, playerTable.x[slot], playerTable.y[slot]);
+    scheduleHeartbeat(slot, HEARTBEAT_TIMEOUT);
+    pendingAccepts.push_back({ command.clientAddr, static_cast<uint16_t>(slot), playerTable.generation[slot],
+        playerTable.x[slot], playerTable.y[slot] });
+    LOG_INFO("Client connected as player {}.", slot);
+}
+
+void Server::handleClientDisconnect(const sockaddr_in& clientAddr) {
+    int slot = slotsByAddress.find(clientAddr);
+    if (slot < 0) {
+        return;
+    }
+
+    removePlayer(slot);
+    LOG_INFO("Client disconnected. Removed from the list of players.");
+}
 
-    for (const auto& client : clients) {
-        int packetSize = sizeof(MessageType) + sizeof(int) + (outgoingPacket.movementUpdates.numPlayers * sizeof(PlayerPositionAndPlayer));
-        int sentBytes = sendto(serverSocket, (char*)&outgoingPacket, packetSize, 0, (struct sockaddr*)&client, sizeof(client));
-        if (sentBytes == SOCKET_ERROR) {
-            std::cerr << "sendto failed." << std::endl;
+void Server::removePlayer(int slot) {
+    std::chrono::duration<double> sessionLength = gameClock() - playerTable.connectedAt[slot];
+    LOG_INFO("Player {} session ended after {} s, {} packets received, {} late or duplicate, {} inputs never received",
+        slot, sessionLength.count(), playerTable.packetsReceived[slot], playerTable.packetsRejected[slot],
+        playerTable.inputs[slot].skipped());
+
+    // The send thread drops its side of the session once the slot leaves the snapshot
+    timers.cancel(playerTable.heartbeatTimer[slot]);
+    slotsByAddress.erase(playerTable.address[slot]);
+    grid.remove(slot);
+    playerTable.release(slot);
+}
+
+void Server::processTimers() {
+    firedTimers.clear();
+    size_t fired = timers.advance(tickCount, firedTimers);
+    timersFired += fired;
+    if (fired > timersFiredMax) {
+        timersFiredMax = fired;
+    }
+
+    for (const TimerWheel::FiredTimer& timer : firedTimers) {
+        switch (timer.kind) {
+        case HeartbeatTimer:
+            onHeartbeatTimer(timer.target, static_cast<uint16_t>(timer.data));
+            break;
+        default:
+            break;
         }
     }
 }
+
+void Server::scheduleHeartbeat(int slot, double seconds) {
+    uint64_t ticks = static_cast<uint64_t>(std::ceil(seconds / tickRate));
+    playerTable.heartbeatTimer[slot] = timers.schedule(ticks, HeartbeatTimer, slot, playerTable.generation[slot]);
+}
+
+void Server::onHeartbeatTimer(int slot, uint16_t generation) {
+    if (!playerTable.isLive(slot, generation)) {
+        return;
+    }
+
+    // Packets only stamp lastKeepAlive; the timer re-arms itself for whatever time is left
+    std::chrono::duration<double> elapsed = gameClock() - playerTable.lastKeepAlive[slot];
+    if (elapsed.count() < HEARTBEAT_TIMEOUT) {
+        scheduleHeartbeat(slot, HEARTBEAT_TIMEOUT - elapsed.count());
+        return;
+    }
+
+    LOG_INFO("Client {} timed out due to no heartbeat.", slot);
+    removePlayer(slot);
+}
+
+void Server::processIncomingPacket(const InboundCommand& command) {
+    if (command.kind == InboundCommand::Connect) {
+        handleClientConnect(command);
+        return;
+    }
+    if (command.kind == InboundCommand::Disconnect) {
+        handleClientDisconnect(command.clientAddr);
+        return;
+    }
+
+    // Drop packets for a slot that has since been released, or sent from another address
+    int slot = command.slot;
+    if (!playerTable.isLive(slot, command.generation) || !sockaddr_in_equal()(playerTable.address[slot], command.clientAddr)) {
+        return;
+    }
+
+    playerTable.packetsReceived[slot]++;
+    ReceiveWindow::Order order = playerTable.receiveWindow[slot].receive(command.header.sequence);
+    if (order == ReceiveWindow::Duplicate) {
+        playerTable.packetsRejected[slot]++;
+        duplicatePackets++;
+        metrics.packetsRejected.add();
+        return;
+    }
+
+    // Acks only ever grow, so the newest packet's ack fields cover every earlier one's
+    if (order == ReceiveWindow::Newest) {
+        playerTable.peerAck[slot] = command.header.ack;
+        playerTable.peerAckBits[slot] = command.header.ackBits;
+        playerTable.peerAckDelay[slot] = command.header.ackDelay;
+        playerTable.peerAckAt[slot] = command.receivedAt;
+    }
+    if (command.snapshotAck > playerTable.ackedTick[slot]) {
+        playerTable.ackedTick[slot] = command.snapshotAck;
+    }
+
+    // Inputs are buffered by the tick they are stamped for, so a late packet may still bring new ones.
+    // A stamp past the buffer's reach means the client has lost track of our clock; it resyncs on its own.
+    if (command.inputCount > 0 && command.inputTick <= tickCount + INPUT_BUFFER_SIZE) {
+        for (int input = 0; input < command.inputCount; ++input) {
+            playerTable.inputs[slot].push(command.inputTick - command.inputCount + 1 + input, command.inputs[input]);
+        }
+    }
+
+    // Answered even from a late packet; the client only wants the timestamps
+    if (command.hasTimeSync) {
+        pendingTimeSyncs.push_back({ command.clientAddr, command.syncRequestedAt, command.receivedAt });
+    }
+
+    // A late packet still proves the client is alive, but its state has already been overtaken
+    if (order == ReceiveWindow::Late) {
+        playerTable.lastKeepAlive[slot] = command.receivedAt;
+        playerTable.packetsRejected[slot]++;
+        latePackets++;
+        metrics.packetsRejected.add();
+        return;
+    }
+
+    playerTable.lastKeepAlive[slot] = command.receivedAt;
+    if (command.hasViewRadius) {
+        playerTable.viewRadius[slot] = std::clamp(command.viewRadius, 0.0f, MAX_VIEW_RADIUS);
+    }
+}
+
+// Advances every player by the inputs stamped for this tick, plus any that
+// missed theirs, one step per input with the same applyPlayerInput the
+// client predicts with
+void Server::simulatePlayers() {
+    uint8_t buttons[INPUT_MAX_PER_TICK];
+    for (int slot = 0; slot < playerTable.highWater(); ++slot) {
+        if (!playerTable.live[slot]) {
+            continue;
+        }
+
+        InputBuffer& inputs = playerTable.inputs[slot];
+        uint64_t lateBefore = inputs.late();
+        int count = inputs.consume(static_cast<uint32_t>(tickCount), buttons);
+        inputsLate += inputs.late() - lateBefore;
+        metrics.inputsLate.add(inputs.late() - lateBefore);
+        if (count == 0) {
+            continue;
+        }
+
+        for (int input = 0; input < count; ++input) {
+            applyPlayerInput(buttons[input], playerTable.x[slot], playerTable.y[slot]);
+        }
+        inputsApplied += count;
+        metrics.inputsApplied.add(count);
+
+        // Only touches the grid's cell lists when the player crossed a cell boundary
+        grid.move(slot, playerTable.x[slot], playerTable.y[slot]);
+    }
+}
+
+void Server::publishSnapshot() {
+    WorldSnapshot& snapshot = snapshots.writeBuffer();
+    snapshot.tick = tickCount;
+    snapshot.tickStart = tickStartedAt;
+    snapshot.visible.clear();
+    snapshot.clients.clear();
+
+    // Handshake replies ride along with the snapshot; one lost to a skipped snapshot is answered again on the client's retry
+    snapshot.accepted.swap(pendingAccepts);
+    pendingAccepts.clear();
+    snapshot.timeSyncs.swap(pendingTimeSyncs);
+    pendingTimeSyncs.clear();
+
+    for (int slot = 0; slot < playerTable.highWater(); ++slot) {
+        if (!playerTable.live[slot]) {
+            continue;
+        }
+
+        const ReceiveWindow& window = playerTable.receiveWindow[slot];
+        ClientView view{ playerTable.address[slot], slot, playerTable.generation[slot], snapshot.visible.size(), 0, playerTable.ackedTick[slot],
+            playerTable.inputs[slot].lastApplied(), window.ack(), window.ackBits(), playerTable.peerAck[slot], playerTable.peerAckBits[slot],
+            playerTable.peerAckDelay[slot], playerTable.peerAckAt[slot] };
+        float centerX = playerTable.x[slot];
+        float centerY = playerTable.y[slot];
+
+        interestScratch.clear();
+        grid.query(centerX, centerY, playerTable.viewRadius[slot], interestScratch);
+
+        // More players in view than we replicate: keep the nearest, so the full snapshot never has to drop any
+        if (interestScratch.size() > MAX_VISIBLE_PLAYERS) {
+            auto distanceSquared = [&](int id) {
+                float dx = playerTable.x[id] - centerX;
+                float dy = playerTable.y[id] - centerY;
+                return dx * dx + dy * dy;
+            };
+            std::nth_element(interestScratch.begin(), interestScratch.begin() + MAX_VISIBLE_PLAYERS, interestScratch.end(),
+                [&](int lhs, int rhs) { return distanceSquared(lhs) < distanceSquared(rhs); });
+            interestScratch.resize(MAX_VISIBLE_PLAYERS);
+        }
+
+        // Sorted ids let the send thread diff against a baseline in one pass
+        std::sort(interestScratch.begin(), interestScratch.end());
+        for (int id : interestScratch) {
+            snapshot.visible.push_back({ id, playerTable.x[id], playerTable.y[id] });
+        }
+
+        view.visibleCount = snapshot.visible.size() - view.firstVisible;
+        snapshot.clients.push_back(view);
+    }
+
+    snapshots.publish();
+    publishedTick.store(tickCount, std::memory_order_release);
+    publishedTick.notify_one();
+}
+
+void Server::sendLoop() {
+    uint64_t lastSentTick = 0;
+    bool sentAny = false;
+
+    while (true) {
+        publishedTick.wait(lastSentTick, std::memory_order_acquire);
+        if (!snapshots.consume()) {
+            continue;
+        }
+
+        const WorldSnapshot& snapshot = snapshots.readBuffer();
+        if (sentAny && snapshot.tick > lastSentTick + 1) {
+            snapshotsSkipped.fetch_add(snapshot.tick - lastSentTick - 1, std::memory_order_relaxed);
+            metrics.snapshotsSkipped.add(snapshot.tick - lastSentTick - 1);
+        }
+        lastSentTick = snapshot.tick;
+        sentAny = true;
+
+        try {
+            auto sendStart = std::chrono::steady_clock::now();
+            sendMovementUpdates(snapshot);
+            metrics.sendDuration.recordDuration(std::chrono::steady_clock::now() - sendStart);
+        }
+        catch (const std::system_error& e) {
+            LOG_ERROR_RATE(1, "System error during snapshot send: {}", e.what());
+        }
+    }
+}
+
+void Server::sendMovementUpdates(const WorldSnapshot& snapshot) {
+    for (const ConnectReply& reply : snapshot.accepted) {
+        OutgoingPacket& packet = fragments[0];
+        packet.header = PacketHeader{};
+        packet.type = ConnectAccepted;
+        packet.tick = static_cast<uint32_t>(snapshot.tick);
+        packet.inputAck = 0;
+        packet.partIndex = 0;
+        packet.partCount = 1;
+        packet.connectData.slot = reply.slot;
+        packet.connectData.generation = reply.generation;
+        packet.connectData.x = reply.x;
+        packet.connectData.y = reply.y;
+        broadcaster->queue(reply.address, &packet, static_cast<int>(SNAPSHOT_HEADER_SIZE + sizeof(packet.connectData)));
+    }
+
+    // Like handshake replies these sit outside the client's sequence space, and queued ahead of
+    // the snapshots they leave at the head of the batch, close to sentAt
+    for (const TimeSyncReply& reply : snapshot.timeSyncs) {
+        OutgoingPacket& packet = fragments[0];
+        packet.header = PacketHeader{};
+        packet.type = TimeSync;
+        packet.tick = static_cast<uint32_t>(snapshot.tick);
+        packet.inputAck = 0;
+        packet.partIndex = 0;
+        packet.partCount = 1;
+        packet.timeSyncData.requestedAt = reply.requestedAt;
+        packet.timeSyncData.receivedAt = serverMicros(reply.receivedAt);
+        packet.timeSyncData.sentAt = serverMicros(gameClock());
+        packet.timeSyncData.tickStart = serverMicros(snapshot.tickStart);
+        broadcaster->queue(reply.address, &packet, static_cast<int>(SNAPSHOT_HEADER_SIZE + sizeof(packet.timeSyncData)));
+    }
+
+    // Clients interpolate between snapshots, so they need not get one every tick; the replies above never wait
+    if (snapshot.tick % snapshotStride != 0) {
+        flushBroadcast();
+        return;
+    }
+
+    auto now = gameClock();
+    size_t nextSlot = 0;
+    size_t deferred = 0;
+    double elapsed = static_cast<double>(std::max<uint64_t>(snapshot.tick - lastSnapshotTick, 1)) * tickRate;
+    lastSnapshotTick = snapshot.tick;
+    for (const ClientView& client : snapshot.clients) {
+        const PlayerPositionAndPlayer* players = snapshot.visible.data() + client.firstVisible;
+        if (client.slot >= static_cast<int>(clientHistories.size())) {
+            clientHistories.resize(client.slot + 1);
+        }
+
+        // Clients arrive in slot order, so every slot skipped over has left
+        releaseClientHistories(nextSlot, client.slot);
+        nextSlot = client.slot + 1;
+
+        // A new occupant of the slot must not be sent deltas against the previous one's baselines
+        ClientHistory& history = clientHistories[client.slot];
+        if (history.generation != client.generation) {
+            history.generation = client.generation;
+            for (SentSnapshot& sent : history.ring) {
+                sent.tick = 0;
+            }
+            history.acks.reset();
+            history.pacing.reset(now);
+        }
+        history.active = true;
+
+        // The same ack comes back every tick until the client sends a newer one; repeats change nothing
+        uint64_t ackedBefore = history.acks.ackedCount();
+        uint64_t lostBefore = history.acks.lostCount();
+        if (history.acks.acknowledge(client.peerAck, client.peerAckBits, client.peerAckDelay, client.peerAckAt)) {
+            metrics.clientRtt.recordDuration(history.acks.lastRtt());
+            rttSamples.fetch_add(1, std::memory_order_relaxed);
+            rttTotalMicros.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(history.acks.lastRtt()).count(), std::memory_order_relaxed);
+        }
+        datagramsAcked.fetch_add(history.acks.ackedCount() - ackedBefore, std::memory_order_relaxed);
+        datagramsLost.fetch_add(history.acks.lostCount() - lostBefore, std::memory_order_relaxed);
+        metrics.packetsAcked.add(history.acks.ackedCount() - ackedBefore);
+        metrics.packetsLost.add(history.acks.lostCount() - lostBefore);
+
+        // Deltas are against whatever the client acked, so a held back snapshot is folded into the next one
+        if (config.adaptiveSendRate) {
+            history.pacing.onAcks(history.acks.lostCount() - lostBefore, history.acks.rtt(), now);
+            if (!history.pacing.due(elapsed)) {
+                deferred++;
+                continue;
+            }
+        }
+
+        // Delta against the newest snapshot the client has acknowledged, if we still have it
+        uint32_t tick = static_cast<uint32_t>(snapshot.tick);
+        int partCount = 0;
+        const SentSnapshot& baseline = history.ring[client.ackedTick % SNAPSHOT_HISTORY];
+        if (client.ackedTick != 0 && baseline.tick == client.ackedTick && snapshot.tick - client.ackedTick < SNAPSHOT_HISTORY) {
+            partCount = encodeDelta(tick, baseline, players, client.visibleCount, encodedPlayers);
+        }
+
+        if (partCount == 0) {
+            partCount = encodeFullSnapshot(tick, players, client.visibleCount, encodedPlayers);
+            fullSnapshotsSent.fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            deltaSnapshotsSent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Remember exactly what the client will reconstruct, quantization included
+        SentSnapshot& sent = history.ring[snapshot.tick % SNAPSHOT_HISTORY];
+        sent.tick = tick;
+        sent.players.swap(encodedPlayers);
+
+        int bytes = 0;
+        for (int part = 0; part < partCount; ++part) {
+            fragments[part].header.sequence = history.acks.send(now);
+            fragments[part].header.ack = client.ack;
+            fragments[part].header.ackBits = client.ackBits;
+            fragments[part].header.ackDelay = encodeAckDelay(now - client.peerAckAt);
+            fragments[part].inputAck = client.inputAck;
+            fragments[part].partCount = static_cast<uint16_t>(partCount);
+            broadcaster->queue(client.address, &fragments[part], fragmentSizes[part]);
+            bytes += fragmentSizes[part];
+        }
+        history.pacing.onSent(bytes);
+        snapshotPartsSent.fetch_add(partCount, std::memory_order_relaxed);
+    }
+    releaseClientHistories(nextSlot, clientHistories.size());
+    snapshotsDeferred.fetch_add(deferred, std::memory_order_relaxed);
+    metrics.snapshotsDeferred.add(deferred);
+    metrics.clientsSendLimited.set(static_cast<double>(deferred));
+    flushBroadcast();
+}
+
+void Server::flushBroadcast() {
+    broadcaster->flush();
+
+    const BroadcastEngine::TickStats& stats = broadcaster->lastTickStats();
+    broadcastTicks.fetch_add(1, std::memory_order_relaxed);
+    broadcastSyscalls.fetch_add(stats.syscalls, std::memory_order_relaxed);
+    broadcastBytes.fetch_add(stats.bytes, std::memory_order_relaxed);
+    metrics.packetsSent.add(stats.datagrams);
+    metrics.bytesSent.add(stats.bytes);
+}
+
+// Frees the baselines of sessions that ended. Even if the snapshot that first
+// left a slot out was skipped, the next one leaves it out too.
+void Server::releaseClientHistories(size_t firstSlot, size_t endSlot) {
+    for (size_t slot = firstSlot; slot < endSlot; ++slot) {
+        ClientHistory& history = clientHistories[slot];
+        if (!history.active) {
+            continue;
+        }
+
+        for (SentSnapshot& sent : history.ring) {
+            sent.tick = 0;
+            std::vector<PlayerPositionAndPlayer>().swap(sent.players);
+        }
+        history.acks.reset();
+        history.active = false;
+    }
+}
+
+// Full snapshot part payload, packed least significant bit first:
+//   fraction bits (5), origin x and y (signed varints, quantized),
+//   x and y offset widths (6 each), entity count (16),
+//   then per entity: id gap from the previous id (signed varint) and the
+//   x and y offsets from the origin at their fixed widths.
+// Entities are packed in id order, starting a new part whenever one fills,
+// until MAX_SNAPSHOT_PARTS is reached. Returns the number of parts.
+int Server::encodeFullSnapshot(uint32_t tick, const PlayerPositionAndPlayer* players, size_t playerCount,
+    std::vector<PlayerPositionAndPlayer>& sent) {
+    // A query keeps players within MAX_VIEW_RADIUS, so offsets fit 16 bits, and MAX_VISIBLE_PLAYERS
+    // entries fit the parts even if each part wastes one entry's worth of space
+    static_assert((static_cast<int>(2 * MAX_VIEW_RADIUS) + 1) << POSITION_FRACTION_BITS < (1 << 16),
+        "Snapshot offsets outgrew SNAPSHOT_ENTRY_MAX_BITS");
+    static_assert(MAX_VISIBLE_PLAYERS <= MAX_SNAPSHOT_PARTS * (((SNAPSHOT_MTU - SNAPSHOT_HEADER_SIZE) * 8 - 5 - 2 * 40 - 6 - 6 - 16) / SNAPSHOT_ENTRY_MAX_BITS),
+        "MAX_VISIBLE_PLAYERS may not fit a full snapshot");
+
+    int32_t minX = 0, minY = 0, maxX = 0, maxY = 0;
+    for (size_t i = 0; i < playerCount; ++i) {
+        int32_t x = quantizePosition(players[i].x, POSITION_FRACTION_BITS);
+        int32_t y = quantizePosition(players[i].y, POSITION_FRACTION_BITS);
+        minX = i == 0 ? x : std::min(minX, x);
+        minY = i == 0 ? y : std::min(minY, y);
+        maxX = i == 0 ? x : std::max(maxX, x);
+        maxY = i == 0 ? y : std::max(maxY, y);
+    }
+    int xBits = bitWidth(static_cast<uint32_t>(maxX - minX));
+    int yBits = bitWidth(static_cast<uint32_t>(maxY - minY));
+
+    sent.clear();
+    size_t next = 0;
+    int partCount = 0;
+    do {
+        OutgoingPacket& packet = fragments[partCount];
+        packet.type = PlayerMovementUpdates;
+        packet.tick = tick;
+        packet.partIndex = static_cast<uint16_t>(partCount);
+
+        BitWriter writer(packet.payload, sizeof(packet.payload));
+        writer.writeBits(POSITION_FRACTION_BITS, 5);
+        writer.writeSignedVarint(minX);
+        writer.writeSignedVarint(minY);
+        writer.writeBits(xBits, 6);
+        writer.writeBits(yBits, 6);
+        size_t countPosition = writer.bitPosition();
+        writer.writeBits(0, 16);
+
+        uint32_t count = 0;
+        int previousId = 0;
+        for (; next < playerCount; ++next) {
+            size_t entryStart = writer.bitPosition();
+            int32_t x = quantizePosition(players[next].x, POSITION_FRACTION_BITS);
+            int32_t y = quantizePosition(players[next].y, POSITION_FRACTION_BITS);
+            writer.writeSignedVarint(players[next].playerId - previousId);
+            writer.writeBits(static_cast<uint32_t>(x - minX), xBits);
+            writer.writeBits(static_cast<uint32_t>(y - minY), yBits);
+            if (writer.overflowed()) {
+                writer.rewind(entryStart);
+                break;
+            }
+
+            previousId = players[next].playerId;
+            sent.push_back({ players[next].playerId, dequantizePosition(x, POSITION_FRACTION_BITS), dequantizePosition(y, POSITION_FRACTION_BITS) });
+            ++count;
+        }
+        writer.patchBits(countPosition, count, 16);
+        fragmentSizes[partCount++] = static_cast<int>(SNAPSHOT_HEADER_SIZE + writer.bytesWritten());
+    } while (next < playerCount && partCount < MAX_SNAPSHOT_PARTS);
+
+    // Only reachable if the bounds above stop holding; the client will not see these players this tick
+    if (next < playerCount) {
+        metrics.snapshotEntriesDropped.add(playerCount - next);
+        LOG_WARN_RATE(1, "Full snapshot for tick {} left out {} of {} players", tick, playerCount - next, playerCount);
+    }
+    return partCount;
+}
+
+// Delta part payload against a baseline the client acknowledged:
+//   baseline tick (32), fraction bits (5), added origin x and y (signed varints)
+//   and offset widths (6 each), removed/changed/added counts (16 each),
+//   removed: id gaps; changed: id gap plus signed varint x and y steps in
+//   quantized units; added: id gap plus offsets as in a full snapshot.
+// Ids restart from zero for each list in each part. Returns the number of
+// parts, or 0 when the delta would need more than MAX_SNAPSHOT_PARTS.
+int Server::encodeDelta(uint32_t tick, const SentSnapshot& baselineSnapshot, const PlayerPositionAndPlayer* players, size_t playerCount,
+    std::vector<PlayerPositionAndPlayer>& sent) {
+    const std::vector<PlayerPositionAndPlayer>& baseline = baselineSnapshot.players;
+
+    // Both lists are sorted by player id, so one merge pass classifies every entry.
+    // Positions are compared after quantization so sub-precision jitter is never resent.
+    std::vector<PlayerPositionAndPlayer>& added = deltaAdded;
+    std::vector<PositionStep>& changed = deltaChanged;
+    std::vector<int>& removed = deltaRemoved;
+    added.clear();
+    changed.clear();
+    removed.clear();
+    sent.clear();
+
+    auto quantized = [](const PlayerPositionAndPlayer& player) {
+        return PlayerPositionAndPlayer{ player.playerId,
+            dequantizePosition(quantizePosition(player.x, POSITION_FRACTION_BITS), POSITION_FRACTION_BITS),
+            dequantizePosition(quantizePosition(player.y, POSITION_FRACTION_BITS), POSITION_FRACTION_BITS) };
+    };
+
+    size_t oldIndex = 0;
+    size_t newIndex = 0;
+    while (oldIndex < baseline.size() || newIndex < playerCount) {
+        if (newIndex == playerCount || (oldIndex < baseline.size() && baseline[oldIndex].playerId < players[newIndex].playerId)) {
+            removed.push_back(baseline[oldIndex++].playerId);
+        }
+        else if (oldIndex == baseline.size() || players[newIndex].playerId < baseline[oldIndex].playerId) {
+            added.push_back(quantized(players[newIndex]));
+            sent.push_back(added.back());
+            ++newIndex;
+        }
+        else {
+            PlayerPositionAndPlayer current = quantized(players[newIndex]);
+            if (current.x != baseline[oldIndex].x || current.y != baseline[oldIndex].y) {
+                changed.push_back({ current.playerId,
+                    quantizePosition(current.x, POSITION_FRACTION_BITS) - quantizePosition(baseline[oldIndex].x, POSITION_FRACTION_BITS),
+                    quantizePosition(current.y, POSITION_FRACTION_BITS) - quantizePosition(baseline[oldIndex].y, POSITION_FRACTION_BITS) });
+            }
+            sent.push_back(current);
+            ++oldIndex;
+            ++newIndex;
+        }
+    }
+
+    int32_t minX = 0, minY = 0, maxX = 0, maxY = 0;
+    for (size_t i = 0; i < added.size(); ++i) {
+        int32_t x = quantizePosition(added[i].x, POSITION_FRACTION_BITS);
+        int32_t y = quantizePosition(added[i].y, POSITION_FRACTION_BITS);
+        minX = i == 0 ? x : std::min(minX, x);
+        minY = i == 0 ? y : std::min(minY, y);
+        maxX = i == 0 ? x : std::max(maxX, x);
+        maxY = i == 0 ? y : std::max(maxY, y);
+    }
+    int xBits = bitWidth(static_cast<uint32_t>(maxX - minX));
+    int yBits = bitWidth(static_cast<uint32_t>(maxY - minY));
+
+    // Removed, then changed, then added entries, filling one part after another
+    size_t total = removed.size() + changed.size() + added.size();
+    size_t next = 0;
+    int partCount = 0;
+    do {
+        if (partCount == MAX_SNAPSHOT_PARTS) {
+            return 0;
+        }
+
+        OutgoingPacket& packet = fragments[partCount];
+        packet.type = PlayerMovementDelta;
+        packet.tick = tick;
+        packet.partIndex = static_cast<uint16_t>(partCount);
+
+        BitWriter writer(packet.payload, sizeof(packet.payload));
+        writer.writeBits(baselineSnapshot.tick, 32);
+        writer.writeBits(POSITION_FRACTION_BITS, 5);
+        writer.writeSignedVarint(minX);
+        writer.writeSignedVarint(minY);
+        writer.writeBits(xBits, 6);
+        writer.writeBits(yBits, 6);
+        size_t countPosition = writer.bitPosition();
+        writer.writeBits(0, 16);
+        writer.writeBits(0, 16);
+        writer.writeBits(0, 16);
+
+        uint32_t counts[3] = { 0, 0, 0 };
+        int previousList = -1;
+        int previousId = 0;
+        for (; next < total; ++next) {
+            size_t entryStart = writer.bitPosition();
+            int list = next < removed.size() ? 0 : next < removed.size() + changed.size() ? 1 : 2;
+            if (list != previousList) {
+                previousList = list;
+                previousId = 0;
+            }
+
+            int playerId;
+            if (list == 0) {
+                playerId = removed[next];
+                writer.writeSignedVarint(playerId - previousId);
+            }
+            else if (list == 1) {
+                const PositionStep& step = changed[next - removed.size()];
+                playerId = step.playerId;
+                writer.writeSignedVarint(playerId - previousId);
+                writer.writeSignedVarint(step.dx);
+                writer.writeSignedVarint(step.dy);
+            }
+            else {
+                const PlayerPositionAndPlayer& player = added[next - removed.size() - changed.size()];
+                playerId = player.playerId;
+                writer.writeSignedVarint(playerId - previousId);
+                writer.writeBits(static_cast<uint32_t>(quantizePosition(player.x, POSITION_FRACTION_BITS) - minX), xBits);
+                writer.writeBits(static_cast<uint32_t>(quantizePosition(player.y, POSITION_FRACTION_BITS) - minY), yBits);
+            }
+
+            if (writer.overflowed()) {
+                writer.rewind(entryStart);
+                break;
+            }
+            previousId = playerId;
+            ++counts[list];
+        }
+
+        writer.patchBits(countPosition, counts[0], 16);
+        writer.patchBits(countPosition + 16, counts[1], 16);
+        writer.patchBits(countPosition + 32, counts[2], 16);
+        fragmentSizes[partCount++] = static_cast<int>(SNAPSHOT_HEADER_SIZE + writer.bytesWritten());
+    } while (next < total);
+
+    return partCount;
+}
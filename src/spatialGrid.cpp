@@ -0,0 +1,132 @@
+#include <alchemy/spatialGrid.h>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float cellSize)
+    : cellSize(cellSize), inverseCellSize(1.0f / cellSize) {}
+
+int64_t SpatialGrid::cellKey(int cellX, int cellY) const {
+    return (static_cast<int64_t>(cellX) << 32) | static_cast<uint32_t>(cellY);
+}
+
+int SpatialGrid::cellCoordinate(float value) const {
+    return static_cast<int>(std::floor(value * inverseCellSize));
+}
+
+void SpatialGrid::attach(int id, Entry& entry) {
+    std::vector<int>& members = cells[entry.cell];
+    entry.slot = static_cast<uint32_t>(members.size());
+    members.push_back(id);
+}
+
+void SpatialGrid::detach(int id, const Entry& entry) {
+    auto cell = cells.find(entry.cell);
+    if (cell == cells.end()) {
+        return;
+    }
+
+    std::vector<int>& members = cell->second;
+    int last = members.back();
+    members[entry.slot] = last;
+    members.pop_back();
+    if (last != id) {
+        entries[last].slot = entry.slot;
+    }
+    if (members.empty()) {
+        cells.erase(cell);
+    }
+}
+
+void SpatialGrid::insert(int id, float x, float y) {
+    if (contains(id)) {
+        move(id, x, y);
+        return;
+    }
+
+    if (id >= static_cast<int>(entries.size())) {
+        entries.resize(id + 1);
+    }
+    Entry& entry = entries[id];
+    entry = Entry{ cellKey(cellCoordinate(x), cellCoordinate(y)), 0, x, y, true };
+    attach(id, entry);
+    count++;
+}
+
+void SpatialGrid::move(int id, float x, float y) {
+    if (!contains(id)) {
+        insert(id, x, y);
+        return;
+    }
+
+    Entry& entry = entries[id];
+    entry.x = x;
+    entry.y = y;
+
+    int64_t cell = cellKey(cellCoordinate(x), cellCoordinate(y));
+    if (cell == entry.cell) {
+        return;
+    }
+
+    detach(id, entry);
+    entry.cell = cell;
+    attach(id, entry);
+}
+
+void SpatialGrid::remove(int id) {
+    if (!contains(id)) {
+        return;
+    }
+
+    detach(id, entries[id]);
+    entries[id].present = false;
+    count--;
+}
+
+bool SpatialGrid::contains(int id) const {
+    return id >= 0 && id < static_cast<int>(entries.size()) && entries[id].present;
+}
+
+void SpatialGrid::query(float x, float y, float radius, std::vector<int>& results) const {
+    int minX = cellCoordinate(x - radius);
+    int maxX = cellCoordinate(x + radius);
+    int minY = cellCoordinate(y - radius);
+    int maxY = cellCoordinate(y + radius);
+    float radiusSquared = radius * radius;
+
+    auto collect = [&](const std::vector<int>& members) {
+        for (int id : members) {
+            const Entry& entry = entries[id];
+            float dx = entry.x - x;
+            float dy = entry.y - y;
+            if (dx * dx + dy * dy <= radiusSquared) {
+                results.push_back(id);
+            }
+        }
+    };
+
+    // A wide radius over a sparse world covers more empty cells than occupied
+    // ones, so walk the occupied cells instead of probing every covered one
+    int64_t coveredCells = static_cast<int64_t>(maxX - minX + 1) * (maxY - minY + 1);
+    if (coveredCells > static_cast<int64_t>(cells.size())) {
+        for (const auto& [key, members] : cells) {
+            int cellX = static_cast<int>(key >> 32);
+            int cellY = static_cast<int>(static_cast<uint32_t>(key));
+            if (cellX >= minX && cellX <= maxX && cellY >= minY && cellY <= maxY) {
+                collect(members);
+            }
+        }
+        return;
+    }
+
+    for (int cellX = minX; cellX <= maxX; ++cellX) {
+        for (int cellY = minY; cellY <= maxY; ++cellY) {
+            auto cell = cells.find(cellKey(cellX, cellY));
+            if (cell != cells.end()) {
+                collect(cell->second);
+            }
+        }
+    }
+}
+
+size_t SpatialGrid::size() const {
+    return count;
+}
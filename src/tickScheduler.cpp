@@ -0,0 +1,83 @@
+#include <alchemy/tickScheduler.h>
+#include <algorithm>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+TickScheduler::TickScheduler(double interval)
+    : tickInterval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval))),
+    nextDeadline(Clock::now() + tickInterval), oversleepEstimate(TICK_SPIN_MARGIN_MIN) {
+#ifdef _WIN32
+    // Default timer resolution is ~15.6 ms, longer than a tick
+    timeBeginPeriod(1);
+#endif
+}
+
+TickScheduler::~TickScheduler() {
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+std::chrono::steady_clock::duration TickScheduler::waitForNextTick() {
+    Clock::time_point now = Clock::now();
+
+    if (now < nextDeadline) {
+        Clock::time_point wakeAt = nextDeadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spinMargin()));
+        if (now < wakeAt) {
+            std::this_thread::sleep_until(wakeAt);
+            now = Clock::now();
+
+            // Track how late sleeps come back so the spin window covers it next time
+            double oversleep = std::chrono::duration<double>(now - wakeAt).count();
+            oversleepEstimate += (std::max(oversleep, 0.0) - oversleepEstimate) * 0.1;
+        }
+
+        while (now < nextDeadline) {
+            std::this_thread::yield();
+            now = Clock::now();
+        }
+    }
+
+    Clock::duration late = now - nextDeadline;
+    double lateness = std::chrono::duration<double>(late).count();
+    stats.ticks++;
+    stats.latenessTotal += lateness;
+    stats.latenessMax = std::max(stats.latenessMax, lateness);
+
+    nextDeadline += tickInterval;
+    if (now - nextDeadline > tickInterval * TICK_MAX_CATCH_UP) {
+        uint64_t behind = static_cast<uint64_t>((now - nextDeadline) / tickInterval);
+        stats.ticksSkipped += behind;
+        nextDeadline = now + tickInterval;
+    }
+    return late;
+}
+
+void TickScheduler::setInterval(double interval) {
+    Clock::duration newInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval));
+    if (newInterval == tickInterval) {
+        return;
+    }
+
+    // Re-base the pending deadline on the new rate so switching rates never waits out a whole idle tick
+    nextDeadline += newInterval - tickInterval;
+    tickInterval = newInterval;
+}
+
+double TickScheduler::interval() const {
+    return std::chrono::duration<double>(tickInterval).count();
+}
+
+double TickScheduler::spinMargin() const {
+    return std::clamp(oversleepEstimate * 2.0, TICK_SPIN_MARGIN_MIN, TICK_SPIN_MARGIN_MAX);
+}
+
+TickScheduler::Stats TickScheduler::takeStats() {
+    Stats taken = stats;
+    stats = Stats();
+    return taken;
+}
@@ -0,0 +1,141 @@
+#include <alchemy/timerWheel.h>
+
+TimerWheel::TimerWheel()
+    : now(0), pendingCount(0) {
+    for (int32_t& head : buckets) {
+        head = -1;
+    }
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t delayTicks, uint32_t kind, int32_t target, uint32_t data) {
+    int32_t index;
+    if (!freeNodes.empty()) {
+        index = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else {
+        index = static_cast<int32_t>(nodes.size());
+        nodes.push_back(Node());
+        nodes[index].generation = 1;
+    }
+
+    Node& node = nodes[index];
+    node.deadline = now + (delayTicks > 0 ? delayTicks : 1);
+    node.kind = kind;
+    node.target = target;
+    node.data = data;
+    place(index);
+    pendingCount++;
+
+    return (static_cast<uint64_t>(node.generation) << 32) | static_cast<uint32_t>(index);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    if (index >= nodes.size() || nodes[index].generation != generation || nodes[index].bucket < 0) {
+        return false;
+    }
+
+    unlink(static_cast<int32_t>(index));
+    release(static_cast<int32_t>(index));
+    return true;
+}
+
+size_t TimerWheel::advance(uint64_t nowTick, std::vector<FiredTimer>& fired) {
+    size_t firedBefore = fired.size();
+
+    while (now < nowTick) {
+        now++;
+
+        // Pull the next span of each coarser level down as the level below wraps
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level) {
+            if ((now & ((uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+
+        int32_t bucket = static_cast<int32_t>(now & (SLOTS - 1));
+        while (buckets[bucket] >= 0) {
+            int32_t index = buckets[bucket];
+            Node& node = nodes[index];
+            unlink(index);
+            fired.push_back({ node.kind, node.target, node.data });
+            release(index);
+        }
+    }
+
+    return fired.size() - firedBefore;
+}
+
+uint64_t TimerWheel::currentTick() const {
+    return now;
+}
+
+size_t TimerWheel::pending() const {
+    return pendingCount;
+}
+
+void TimerWheel::place(int32_t index) {
+    uint64_t deadline = nodes[index].deadline;
+    uint64_t delta = deadline - now;
+
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        if (delta < (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+            int32_t slot = static_cast<int32_t>((deadline >> (TIMER_WHEEL_SLOT_BITS * level)) & (SLOTS - 1));
+            link(index, level * SLOTS + slot);
+            return;
+        }
+    }
+
+    // Beyond the wheel's range: park in the farthest top-level slot and re-place on each cascade
+    int top = TIMER_WHEEL_LEVELS - 1;
+    uint64_t parked = now + (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    int32_t slot = static_cast<int32_t>((parked >> (TIMER_WHEEL_SLOT_BITS * top)) & (SLOTS - 1));
+    link(index, top * SLOTS + slot);
+}
+
+void TimerWheel::link(int32_t index, int32_t bucket) {
+    Node& node = nodes[index];
+    node.bucket = bucket;
+    node.prev = -1;
+    node.next = buckets[bucket];
+    if (node.next >= 0) {
+        nodes[node.next].prev = index;
+    }
+    buckets[bucket] = index;
+}
+
+void TimerWheel::unlink(int32_t index) {
+    Node& node = nodes[index];
+    if (node.prev >= 0) {
+        nodes[node.prev].next = node.next;
+    }
+    else {
+        buckets[node.bucket] = node.next;
+    }
+    if (node.next >= 0) {
+        nodes[node.next].prev = node.prev;
+    }
+    node.bucket = -1;
+}
+
+void TimerWheel::release(int32_t index) {
+    nodes[index].generation++;
+    nodes[index].bucket = -1;
+    freeNodes.push_back(index);
+    pendingCount--;
+}
+
+void TimerWheel::cascade(int level) {
+    int32_t bucket = level * SLOTS + static_cast<int32_t>((now >> (TIMER_WHEEL_SLOT_BITS * level)) & (SLOTS - 1));
+    int32_t index = buckets[bucket];
+    buckets[bucket] = -1;
+
+    while (index >= 0) {
+        int32_t next = nodes[index].next;
+        place(index);
+        index = next;
+    }
+}
@@ -0,0 +1,587 @@
+// Headless bot load generator for the server, the standard scale benchmark.
+//
+// Simulates many clients from a few threads, each with its own source port,
+// speaking the same protocol as the game client: the slot handshake, then
+// sequenced ClientUpdate datagrams carrying one movement input per send
+// (none for idle bots) and acknowledging the newest snapshot and datagram
+// received. The server simulates the movement, so bots steer by predicting
+// their own position with the shared step from playerInput.h. Like the game
+// client, each bot synchronizes its clock with the server's (clockSync.h)
+// and stamps every input with the server tick it can reach in time; bots
+// send no input until their first sync reply. Snapshots are reassembled
+// from their parts but not decoded, which is enough to measure what the
+// server delivers:
+//
+//   snapshots/sec   complete snapshots received, in total and per client
+//   loss            snapshots a client never got complete; pass the server's
+//                   --snapshot-rate here too when it sends fewer than one per tick
+//   delay           how much later than its best a client's snapshots arrive;
+//                   each is stamped with its tick, so each client's fastest
+//                   arrival against the tick clock is its baseline
+//
+// Bots start wherever the server spawns them, so the server's --spawn-area
+// sets how crowded they are:
+//   walk    bots wander inside the world, bouncing off its edges; with a
+//           spawn area as large as --world views rarely overlap
+//   battle  bots skirmish within --cluster-radius of their spawn point; with
+//           a small spawn area this is the worst case for snapshot size
+//   idle    bots stand still and only send heartbeats
+//
+//   game --server --spawn-area 500   then   loadgen --clients 2000 --threads 4 --pattern walk
+//   game --server --spawn-area 40    then   loadgen --clients 2000 --threads 4 --pattern battle
+//
+// Keep --rate at the server tick rate for movement: the server applies one
+// input per tick, and a faster bot only stamps its inputs further ahead. The
+// server's "arrived late" count shows inputs that missed their tick anyway.
+//
+// With --rate 0 every thread sends as fast as it can, which is how the
+// receive path is benchmarked; compare the server's "Receive rate" lines.
+// Start the server with --client-rate 0 for that, or its per-address rate
+// limit drops most of the flood before it is decoded.
+
+#include <alchemy/socketPlatform.h>
+#include <alchemy/network_protocol.h>
+#include <alchemy/metrics.h>
+#include <alchemy/bitstream.h>
+#include <alchemy/playerInput.h>
+#include <alchemy/clockSync.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOT_DELAY_WARMUP 64 // Snapshots per client before delays are recorded, while the baseline settles
+#define BOT_VIEW_RADIUS_INTERVAL 1.0 // Seconds between view radius resends, as the game client does
+#define BOT_RECEIVE_POLL_MS 1 // Receive sweep interval on platforms without epoll
+
+enum MovementPattern {
+    RandomWalk,
+    ClusteredBattle,
+    Idle,
+};
+
+struct LoadgenConfig {
+    std::string host = "127.0.0.1";
+    int clients = 500;
+    int threads = 4;
+    int seconds = 10;
+    double rate = 64.0; // Packets per client per second, 0 = unthrottled
+    double serverTickRate = 64.0; // Server ticks per second
+    double snapshotRate = 0.0;    // Snapshots the server sends each client per second, 0 = one per tick
+    MovementPattern pattern = RandomWalk;
+    float worldSize = 500.0f;
+    float clusterRadius = 20.0f;
+    float viewRadius = 30.0f;
+};
+
+struct BotInput {
+    uint32_t tick;
+    uint8_t buttons;
+};
+
+struct Bot {
+    SOCKET socket;
+    OutGoingPacket packet;
+    float x, y; // Predicted, the server has the real position
+    float spawnX, spawnY;
+    float heading;
+    ClockSync clock{ SERVER_TICK_INTERVAL };
+    std::chrono::steady_clock::time_point nextSync;
+    uint32_t inputTick = 0; // Server tick of the newest input sent
+    uint32_t inputAck = 0;  // Newest input the server has applied
+    BotInput inputs[INPUT_REDUNDANCY]; // By server tick
+    uint16_t sequence = 0; // Last sequence sent
+    ReceiveWindow receiveWindow;
+    std::chrono::steady_clock::time_point newestReceivedAt; // Arrival of the datagram we ack
+
+    // Snapshot currently being reassembled
+    uint32_t assemblyTick = 0;
+    uint16_t assemblyParts = 0;
+    uint32_t receivedParts = 0;
+
+    uint32_t firstTick = 0;
+    uint32_t latestTick = 0;
+    uint64_t snapshots = 0;
+    double bestOffset = 0.0; // Smallest arrival time minus tick time seen, seconds
+    double delayTotal = 0.0;
+    uint64_t delaySamples = 0;
+};
+
+static std::atomic<uint64_t> packetsSent{ 0 };
+static std::atomic<uint64_t> bytesSent{ 0 };
+static std::atomic<uint64_t> datagramsReceived{ 0 };
+static std::atomic<uint64_t> bytesReceived{ 0 };
+static std::atomic<uint64_t> snapshotsReceived{ 0 };
+static std::atomic<uint64_t> connectedBots{ 0 };
+static std::atomic<bool> running{ true };
+static Histogram snapshotDelay; // Nanoseconds, all bots
+static std::chrono::steady_clock::time_point startTime;
+
+// Per-client results, filled in by each thread as it finishes
+static std::vector<Bot> finishedBots;
+static std::mutex finishedBotsMutex;
+
+static void printUsage() {
+    std::cout << "Usage: loadgen [--host ADDR] [--clients N] [--threads N] [--seconds N] [--rate HZ]\n"
+        << "               [--pattern walk|battle|idle] [--world SIZE] [--cluster-radius UNITS]\n"
+        << "               [--view-radius UNITS] [--tick-rate HZ] [--snapshot-rate HZ]\n";
+}
+
+static bool parseArguments(int argc, char** argv, LoadgenConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (argument == "--host") config.host = value;
+        else if (argument == "--clients") config.clients = std::atoi(value.c_str());
+        else if (argument == "--threads") config.threads = std::atoi(value.c_str());
+        else if (argument == "--seconds") config.seconds = std::atoi(value.c_str());
+        else if (argument == "--rate") config.rate = std::atof(value.c_str());
+        else if (argument == "--tick-rate") config.serverTickRate = std::atof(value.c_str());
+        else if (argument == "--snapshot-rate") config.snapshotRate = std::atof(value.c_str());
+        else if (argument == "--world") config.worldSize = static_cast<float>(std::atof(value.c_str()));
+        else if (argument == "--cluster-radius") config.clusterRadius = static_cast<float>(std::atof(value.c_str()));
+        else if (argument == "--view-radius") config.viewRadius = static_cast<float>(std::atof(value.c_str()));
+        else if (argument == "--pattern") {
+            if (value == "walk") config.pattern = RandomWalk;
+            else if (value == "battle") config.pattern = ClusteredBattle;
+            else if (value == "idle") config.pattern = Idle;
+            else return false;
+        }
+        else return false;
+    }
+    return config.clients > 0 && config.threads > 0 && config.seconds > 0 && config.serverTickRate > 0.0;
+}
+
+static void setNonBlocking(SOCKET socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(socket, FIONBIO, &mode);
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+// Runs the slot handshake for every bot at once; bots the server never answers are dropped
+static void connectClients(const sockaddr_in& serverAddr, std::vector<Bot>& bots) {
+    OutGoingPacket request;
+    std::memset(&request, 0, sizeof(request));
+    request.type = Connect;
+
+    std::vector<bool> connected(bots.size(), false);
+    size_t connectedCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto nextAttempt = start;
+    auto retryInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(CONNECT_RETRY_INTERVAL));
+    auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(CONNECT_TIMEOUT));
+
+    IncomingPacket reply;
+    while (connectedCount < bots.size() && std::chrono::steady_clock::now() - start < timeout) {
+        if (std::chrono::steady_clock::now() >= nextAttempt) {
+            for (size_t i = 0; i < bots.size(); ++i) {
+                if (!connected[i]) {
+                    sendto(bots[i].socket, (char*)&request, sizeof(OutGoingPacket), 0, (const struct sockaddr*)&serverAddr, sizeof(serverAddr));
+                }
+            }
+            nextAttempt += retryInterval;
+        }
+
+        for (size_t i = 0; i < bots.size(); ++i) {
+            int received;
+            while ((received = recv(bots[i].socket, (char*)&reply, sizeof(IncomingPacket), 0)) > 0) {
+                if (!connected[i] && reply.type == ConnectAccepted && received >= static_cast<int>(SNAPSHOT_HEADER_SIZE + sizeof(reply.connectData))) {
+                    bots[i].packet.slot = reply.connectData.slot;
+                    bots[i].packet.generation = reply.connectData.generation;
+                    bots[i].x = bots[i].spawnX = reply.connectData.x;
+                    bots[i].y = bots[i].spawnY = reply.connectData.y;
+                    connected[i] = true;
+                    connectedCount++;
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < bots.size(); ++i) {
+        if (connected[i]) {
+            bots[kept++] = bots[i];
+        }
+        else {
+            closesocket(bots[i].socket);
+        }
+    }
+    if (kept < bots.size()) {
+        std::cerr << (bots.size() - kept) << " clients could not connect." << std::endl;
+    }
+    bots.resize(kept);
+    connectedBots.fetch_add(kept, std::memory_order_relaxed);
+}
+
+// Steers the bot and turns its heading into the held buttons, predicting where they take it.
+// The input is for the first server tick it can still reach, and never one already used.
+static void moveBot(const LoadgenConfig& config, Bot& bot, float dt, std::chrono::steady_clock::time_point now, std::mt19937& rng) {
+    std::uniform_real_distribution<float> turn(-1.5f, 1.5f);
+    bot.heading += turn(rng) * dt * 4.0f;
+
+    if (config.pattern == ClusteredBattle) {
+        // Skirmish around the spawn point: steer back towards it once outside the radius
+        float dx = bot.spawnX - bot.x;
+        float dy = bot.spawnY - bot.y;
+        if (dx * dx + dy * dy > config.clusterRadius * config.clusterRadius) {
+            bot.heading = std::atan2(dy, dx);
+        }
+    }
+    else {
+        // Bounce off the world edges
+        if ((bot.x < 0.0f && std::cos(bot.heading) < 0.0f) || (bot.x > config.worldSize && std::cos(bot.heading) > 0.0f)) {
+            bot.heading = 3.1415927f - bot.heading;
+        }
+        if ((bot.y < 0.0f && std::sin(bot.heading) < 0.0f) || (bot.y > config.worldSize && std::sin(bot.heading) > 0.0f)) {
+            bot.heading = -bot.heading;
+        }
+    }
+
+    // Eight directions, like a player on WASD
+    uint8_t buttons = 0;
+    float cosine = std::cos(bot.heading);
+    float sine = std::sin(bot.heading);
+    if (cosine > 0.38f) buttons |= InputRight;
+    if (cosine < -0.38f) buttons |= InputLeft;
+    if (sine > 0.38f) buttons |= InputUp;
+    if (sine < -0.38f) buttons |= InputDown;
+
+    bot.inputTick = std::max(bot.clock.targetTick(now), bot.inputTick + 1);
+    bot.inputs[bot.inputTick % INPUT_REDUNDANCY] = { bot.inputTick, buttons };
+    applyPlayerInput(buttons, bot.x, bot.y);
+}
+
+static void stampHeader(Bot& bot, OutGoingPacket& packet, std::chrono::steady_clock::time_point now) {
+    bot.sequence = nextSequence(bot.sequence);
+    packet.header.sequence = bot.sequence;
+    packet.header.ack = bot.receiveWindow.ack();
+    packet.header.ackBits = bot.receiveWindow.ackBits();
+    packet.header.ackDelay = encodeAckDelay(now - bot.newestReceivedAt);
+}
+
+// Packs the bot's unacknowledged inputs, its view radius and a time sync request when due, into one ClientUpdate;
+// returns the datagram length
+static int writeUpdate(const LoadgenConfig& config, Bot& bot, bool withViewRadius, bool withTimeSync,
+    std::chrono::steady_clock::time_point now) {
+    OutGoingPacket& packet = bot.packet;
+    stampHeader(bot, packet, now);
+
+    // Only the run of consecutive ticks ending at the newest input fits one record
+    uint32_t inputCount = 0;
+    while (inputCount < INPUT_REDUNDANCY && bot.inputTick - inputCount > bot.inputAck &&
+        bot.inputs[(bot.inputTick - inputCount) % INPUT_REDUNDANCY].tick == bot.inputTick - inputCount) {
+        inputCount++;
+    }
+    BitWriter writer(packet.records, sizeof(packet.records));
+    writer.writeBits((inputCount > 0 ? 1 : 0) + (withViewRadius ? 1 : 0) + (withTimeSync ? 1 : 0), UPDATE_RECORD_COUNT_BITS);
+    if (inputCount > 0) {
+        writer.writeBits(InputRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(bot.inputTick, 32);
+        writer.writeBits(inputCount, INPUT_COUNT_BITS);
+        for (uint32_t tick = bot.inputTick - inputCount + 1; tick <= bot.inputTick; ++tick) {
+            writer.writeBits(bot.inputs[tick % INPUT_REDUNDANCY].buttons, INPUT_BUTTON_BITS);
+        }
+    }
+    if (withViewRadius) {
+        uint32_t radius;
+        std::memcpy(&radius, &config.viewRadius, sizeof(float));
+        writer.writeBits(ViewRadiusRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(radius, 32);
+    }
+    if (withTimeSync) {
+        writer.writeBits(TimeSyncRecord, UPDATE_RECORD_TAG_BITS);
+        writer.writeBits(ClockSync::requestTime(now), 32);
+    }
+    return static_cast<int>(offsetof(OutGoingPacket, records) + writer.bytesWritten());
+}
+
+static void receiveSnapshotPart(const LoadgenConfig& config, Bot& bot, const IncomingPacket& packet, int received,
+    std::chrono::steady_clock::time_point now) {
+    datagramsReceived.fetch_add(1, std::memory_order_relaxed);
+    bytesReceived.fetch_add(received, std::memory_order_relaxed);
+
+    if (packet.type == TimeSync) {
+        if (received >= static_cast<int>(SNAPSHOT_HEADER_SIZE + sizeof(packet.timeSyncData))) {
+            bot.clock.addSample(packet.timeSyncData.requestedAt, packet.timeSyncData.receivedAt, packet.timeSyncData.sentAt,
+                packet.tick, packet.timeSyncData.tickStart, now);
+        }
+        return;
+    }
+    if ((packet.type != PlayerMovement && packet.type != PlayerMovementDelta) || received < static_cast<int>(SNAPSHOT_HEADER_SIZE)) {
+        return;
+    }
+    // Stale parts are still acked so the server does not count them as lost
+    ReceiveWindow::Order order = bot.receiveWindow.receive(packet.header.sequence);
+    if (order == ReceiveWindow::Duplicate) {
+        return;
+    }
+    if (order == ReceiveWindow::Newest) {
+        bot.newestReceivedAt = now;
+    }
+    if (packet.inputAck > bot.inputAck && packet.inputAck <= bot.inputTick) {
+        bot.inputAck = packet.inputAck;
+    }
+    if (packet.partCount == 0 || packet.partCount > MAX_SNAPSHOT_PARTS || packet.partIndex >= packet.partCount ||
+        packet.tick <= bot.latestTick) {
+        return;
+    }
+
+    // One snapshot in flight per bot; parts of a newer tick abandon an unfinished one
+    if (packet.tick != bot.assemblyTick) {
+        bot.assemblyTick = packet.tick;
+        bot.assemblyParts = packet.partCount;
+        bot.receivedParts = 0;
+    }
+    bot.receivedParts |= 1u << packet.partIndex;
+    if (bot.receivedParts != (1u << bot.assemblyParts) - 1) {
+        return;
+    }
+
+    if (bot.snapshots == 0) {
+        bot.firstTick = packet.tick;
+    }
+    bot.latestTick = packet.tick;
+    bot.snapshots++;
+    bot.packet.snapshotAck = packet.tick;
+    snapshotsReceived.fetch_add(1, std::memory_order_relaxed);
+
+    double offset = std::chrono::duration<double>(now - startTime).count() - packet.tick / config.serverTickRate;
+    if (bot.snapshots == 1 || offset < bot.bestOffset) {
+        bot.bestOffset = offset;
+    }
+    if (bot.snapshots > BOT_DELAY_WARMUP) {
+        double delay = offset - bot.bestOffset;
+        bot.delayTotal += delay;
+        bot.delaySamples++;
+        snapshotDelay.record(static_cast<uint64_t>(delay * 1e9));
+    }
+}
+
+static void receiveAll(const LoadgenConfig& config, Bot& bot) {
+    IncomingPacket packet;
+    int received;
+    while ((received = recv(bot.socket, (char*)&packet, sizeof(IncomingPacket), 0)) > 0) {
+        receiveSnapshotPart(config, bot, packet, received, std::chrono::steady_clock::now());
+    }
+}
+
+static void runClients(const LoadgenConfig& config, const sockaddr_in& serverAddr, int firstClient, int clientCount) {
+    std::mt19937 rng(static_cast<uint32_t>(firstClient) + 1);
+
+    std::vector<Bot> bots;
+    for (int i = 0; i < clientCount; ++i) {
+        SOCKET socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (socket == INVALID_SOCKET) {
+            std::cerr << "Socket creation failed with error code: " << lastSocketError() << std::endl;
+            break;
+        }
+        setNonBlocking(socket);
+
+        Bot bot{};
+        bot.socket = socket;
+        bot.packet.type = ClientUpdate;
+        bot.heading = std::uniform_real_distribution<float>(0.0f, 6.2831853f)(rng);
+        bots.push_back(bot);
+    }
+    connectClients(serverAddr, bots);
+
+#ifdef __linux__
+    int epollFd = epoll_create1(0);
+    for (size_t i = 0; i < bots.size(); ++i) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, bots[i].socket, &event);
+    }
+    std::vector<epoll_event> ready(std::max<size_t>(bots.size(), 1));
+#endif
+
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(config.rate > 0.0 ? 1.0 / config.rate : 0.0));
+    auto nextSend = std::chrono::steady_clock::now();
+    auto lastMove = nextSend;
+    auto nextViewRadius = nextSend;
+
+    while (running.load(std::memory_order_relaxed)) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextSend) {
+            float dt = std::chrono::duration<float>(now - lastMove).count();
+            lastMove = now;
+            bool sendViewRadius = now >= nextViewRadius;
+            if (sendViewRadius) {
+                nextViewRadius = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(BOT_VIEW_RADIUS_INTERVAL));
+            }
+
+            for (Bot& bot : bots) {
+                if (config.pattern != Idle && bot.clock.synchronized()) {
+                    moveBot(config, bot, dt, now, rng);
+                }
+                bool sendTimeSync = now >= bot.nextSync;
+                if (sendTimeSync) {
+                    double syncInterval = bot.clock.samples() < CLOCK_SYNC_SAMPLES ? CLOCK_SYNC_FAST_INTERVAL : CLOCK_SYNC_INTERVAL;
+                    bot.nextSync = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(syncInterval));
+                }
+                int length = writeUpdate(config, bot, sendViewRadius, sendTimeSync, now);
+                if (sendto(bot.socket, (char*)&bot.packet, length, 0, (const struct sockaddr*)&serverAddr, sizeof(serverAddr)) != SOCKET_ERROR) {
+                    packetsSent.fetch_add(1, std::memory_order_relaxed);
+                    bytesSent.fetch_add(length, std::memory_order_relaxed);
+                }
+            }
+            nextSend = config.rate > 0.0 ? std::max(nextSend + interval, now - interval) : now;
+        }
+
+        // Wait for snapshots until the next send is due
+        auto waitTime = std::chrono::duration_cast<std::chrono::milliseconds>(nextSend - std::chrono::steady_clock::now());
+#ifdef __linux__
+        int readyCount = epoll_wait(epollFd, ready.data(), static_cast<int>(ready.size()), std::max<int>(0, static_cast<int>(waitTime.count())));
+        for (int i = 0; i < readyCount; ++i) {
+            receiveAll(config, bots[ready[i].data.u32]);
+        }
+#else
+        for (Bot& bot : bots) {
+            receiveAll(config, bot);
+        }
+        if (waitTime.count() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(BOT_RECEIVE_POLL_MS));
+        }
+#endif
+    }
+
+#ifdef __linux__
+    close(epollFd);
+#endif
+    for (Bot& bot : bots) {
+        closesocket(bot.socket);
+    }
+
+    std::lock_guard<std::mutex> lock(finishedBotsMutex);
+    finishedBots.insert(finishedBots.end(), bots.begin(), bots.end());
+}
+
+static void printSummary(const LoadgenConfig& config) {
+    uint64_t expected = 0;
+    uint64_t received = 0;
+    std::vector<double> clientDelays;
+    std::vector<double> clientRtts;
+    // Rounded to whole ticks the way the server does
+    uint32_t stride = config.snapshotRate > 0.0 ? static_cast<uint32_t>(std::max(1L, std::lround(config.serverTickRate / config.snapshotRate))) : 1;
+    for (const Bot& bot : finishedBots) {
+        if (bot.clock.synchronized()) {
+            clientRtts.push_back(bot.clock.rtt());
+        }
+        if (bot.snapshots > 0) {
+            expected += (bot.latestTick - bot.firstTick) / stride + 1;
+            received += bot.snapshots;
+        }
+        if (bot.delaySamples > 0) {
+            clientDelays.push_back(bot.delayTotal / bot.delaySamples);
+        }
+    }
+
+    std::cout << "Total " << packetsSent.load() << " packets sent, " << packetsSent.load() / config.seconds << " packets/sec average ("
+        << bytesSent.load() / config.seconds / 1024 << " KiB/sec)" << std::endl;
+    std::cout << "Received " << received << " snapshots in " << datagramsReceived.load() << " datagrams ("
+        << bytesReceived.load() / config.seconds / 1024 << " KiB/sec), "
+        << (expected > 0 ? 100.0 * (expected - received) / expected : 0.0) << "% lost" << std::endl;
+
+    std::unique_ptr<Histogram::Snapshot> delays = std::make_unique<Histogram::Snapshot>();
+    snapshotDelay.snapshot(*delays);
+    std::cout << "Snapshot delay p50 " << delays->valueAtQuantile(0.5) / 1e6 << " ms, p90 " << delays->valueAtQuantile(0.9) / 1e6
+        << " ms, p99 " << delays->valueAtQuantile(0.99) / 1e6 << " ms, max " << delays->max / 1e6 << " ms" << std::endl;
+
+    if (!clientDelays.empty()) {
+        std::sort(clientDelays.begin(), clientDelays.end());
+        std::cout << "Per-client average delay best " << clientDelays.front() * 1000.0 << " ms, median "
+            << clientDelays[clientDelays.size() / 2] * 1000.0 << " ms, worst " << clientDelays.back() * 1000.0 << " ms" << std::endl;
+    }
+    if (!clientRtts.empty()) {
+        std::sort(clientRtts.begin(), clientRtts.end());
+        std::cout << "Clocks synchronized on " << clientRtts.size() << " of " << finishedBots.size() << " clients, median RTT "
+            << clientRtts[clientRtts.size() / 2] * 1000.0 << " ms" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    LoadgenConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        printUsage();
+        return 1;
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed." << std::endl;
+        return 1;
+    }
+#endif
+
+    sockaddr_in serverAddr{};
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(SERVER_PORT);
+    if (inet_pton(AF_INET, config.host.c_str(), &serverAddr.sin_addr) <= 0) {
+        std::cerr << "Invalid address / Address not supported" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Simulating " << config.clients << " clients on " << config.threads << " threads for "
+        << config.seconds << " seconds..." << std::endl;
+
+    startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    int clientsPerThread = (config.clients + config.threads - 1) / config.threads;
+    for (int t = 0; t < config.threads; ++t) {
+        int firstClient = t * clientsPerThread;
+        int clientCount = std::min(clientsPerThread, config.clients - firstClient);
+        if (clientCount <= 0) {
+            break;
+        }
+        threads.emplace_back(runClients, std::cref(config), std::cref(serverAddr), firstClient, clientCount);
+    }
+
+    uint64_t previousSent = 0;
+    uint64_t previousSnapshots = 0;
+    uint64_t previousDatagrams = 0;
+    for (int second = 0; second < config.seconds; ++second) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        uint64_t sent = packetsSent.load(std::memory_order_relaxed);
+        uint64_t snapshots = snapshotsReceived.load(std::memory_order_relaxed);
+        uint64_t datagrams = datagramsReceived.load(std::memory_order_relaxed);
+        uint64_t clients = std::max<uint64_t>(connectedBots.load(std::memory_order_relaxed), 1);
+        std::cout << "Sent " << (sent - previousSent) << " packets/sec, received " << (snapshots - previousSnapshots)
+            << " snapshots/sec (" << static_cast<double>(snapshots - previousSnapshots) / clients << " per client) in "
+            << (datagrams - previousDatagrams) << " datagrams" << std::endl;
+        previousSent = sent;
+        previousSnapshots = snapshots;
+        previousDatagrams = datagrams;
+    }
+
+    running = false;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    printSummary(config);
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}